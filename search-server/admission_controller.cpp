@@ -0,0 +1,105 @@
+#include "admission_controller.h"
+
+#include <algorithm>
+#include <utility>
+
+AdmissionController::Ticket::Ticket(AdmissionController* controller, size_t cost)
+    : controller_(controller)
+    , cost_(cost) {
+}
+
+AdmissionController::Ticket::Ticket(Ticket&& other) noexcept
+    : controller_(std::exchange(other.controller_, nullptr))
+    , cost_(other.cost_) {
+}
+
+AdmissionController::Ticket& AdmissionController::Ticket::operator=(Ticket&& other) noexcept {
+    if (this != &other) {
+        Release();
+        controller_ = std::exchange(other.controller_, nullptr);
+        cost_ = other.cost_;
+    }
+    return *this;
+}
+
+AdmissionController::Ticket::~Ticket() {
+    Release();
+}
+
+size_t AdmissionController::Ticket::GetCost() const {
+    return cost_;
+}
+
+void AdmissionController::Ticket::Release() {
+    if (controller_) {
+        std::exchange(controller_, nullptr)->Release(cost_);
+    }
+}
+
+AdmissionController::AdmissionController(size_t max_in_flight_cost, size_t max_queue_length)
+    : max_in_flight_cost_(max_in_flight_cost)
+    , max_queue_length_(max_queue_length) {
+}
+
+std::optional<AdmissionController::Ticket> AdmissionController::Admit(size_t cost, Clock::duration max_wait) {
+    cost = std::min(cost, max_in_flight_cost_);
+    const auto fits = [this, cost] {
+        return in_flight_cost_ + cost <= max_in_flight_cost_;
+    };
+
+    std::unique_lock lock(mutex_);
+    if (queue_.empty() && fits()) {
+        in_flight_cost_ += cost;
+        ++admitted_count_;
+        return Ticket(this, cost);
+    }
+    if (queue_.size() >= max_queue_length_ || max_wait <= Clock::duration::zero()) {
+        ++shed_count_;
+        return std::nullopt;
+    }
+
+    const uint64_t waiter = next_waiter_++;
+    queue_.push_back(waiter);
+    const bool is_admitted = changed_.wait_for(lock, max_wait, [this, waiter, &fits] {
+        return queue_.front() == waiter && fits();
+    });
+    queue_.erase(std::find(queue_.begin(), queue_.end(), waiter));
+    // Either way the queue has a new head, which may fit now.
+    changed_.notify_all();
+
+    if (!is_admitted) {
+        ++shed_count_;
+        return std::nullopt;
+    }
+    in_flight_cost_ += cost;
+    ++admitted_count_;
+    return Ticket(this, cost);
+}
+
+size_t AdmissionController::GetInFlightCost() const {
+    std::lock_guard lock(mutex_);
+    return in_flight_cost_;
+}
+
+size_t AdmissionController::GetQueueLength() const {
+    std::lock_guard lock(mutex_);
+    return queue_.size();
+}
+
+uint64_t AdmissionController::GetAdmittedCount() const {
+    std::lock_guard lock(mutex_);
+    return admitted_count_;
+}
+
+uint64_t AdmissionController::GetShedCount() const {
+    std::lock_guard lock(mutex_);
+    return shed_count_;
+}
+
+void AdmissionController::Release(size_t cost) {
+    {
+        std::lock_guard lock(mutex_);
+        in_flight_cost_ -= cost;
+    }
+    changed_.notify_all();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Bounds the cost of the queries in flight, e.g. the postings they read
+// (SearchServer::EstimateQueryCost). A query that does not fit waits in a
+// FIFO queue of bounded length and is shed if the queue is full or its wait
+// times out. A query costlier than the limit is charged the limit, so it
+// runs alone instead of never.
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Releases the admitted cost when destroyed.
+    class Ticket {
+    public:
+        Ticket(Ticket&& other) noexcept;
+        Ticket& operator=(Ticket&& other) noexcept;
+        ~Ticket();
+
+        size_t GetCost() const;
+
+    private:
+        friend class AdmissionController;
+
+        Ticket(AdmissionController* controller, size_t cost);
+
+        void Release();
+
+        AdmissionController* controller_;
+        size_t cost_;
+    };
+
+    AdmissionController(size_t max_in_flight_cost, size_t max_queue_length);
+
+    // std::nullopt if the query is shed.
+    std::optional<Ticket> Admit(size_t cost, Clock::duration max_wait);
+
+    size_t GetInFlightCost() const;
+    size_t GetQueueLength() const;
+    uint64_t GetAdmittedCount() const;
+    uint64_t GetShedCount() const;
+
+private:
+    const size_t max_in_flight_cost_;
+    const size_t max_queue_length_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    size_t in_flight_cost_ = 0;
+    // Waiting queries by arrival; only the first one may be admitted.
+    std::deque<uint64_t> queue_;
+    uint64_t next_waiter_ = 0;
+    uint64_t admitted_count_ = 0;
+    uint64_t shed_count_ = 0;
+
+    void Release(size_t cost);
+};
@@ -0,0 +1,853 @@
+#include "admission_controller.h"
+#include "document_file.h"
+#include "durable_search_server.h"
+#include "flat_index.h"
+#include "frozen_search_server.h"
+#include "numa_search_server.h"
+#include "perf_profile.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+
+#include "corpus_generator.h"
+#include "generators.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Reproducible benchmark suite. Every measurement is printed as one JSON
+// object per line, so the output of two commits can be diffed or loaded
+// into a notebook directly.
+//
+// Usage: benchmark [--quick] [--repetitions=N] [--warmup=N] [--seed=N]
+//                  [--zipf=S] [--workload=dictionary|corpus]
+//                  [--label=TEXT] [--output=FILE]
+//
+// The dictionary workload draws 70-word documents from a 1000-word
+// dictionary; the corpus workload uses CorpusGenerator, with a large
+// Zipf vocabulary, log-normal document lengths and mixed statuses.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+    bool quick = false;
+    int repetitions = 5;
+    int warmup = 1;
+    unsigned seed = 42;
+    double zipf_exponent = 1.0;
+    std::string workload = "dictionary";
+    std::string label;
+    std::string output;
+    // Hardware counter profile of the query scopes, printed to stderr.
+    bool perf = false;
+    // Empty for every scope.
+    std::vector<std::string> perf_scopes;
+};
+
+struct BenchmarkCase {
+    std::string name;
+    std::string policy;
+    int corpus_size = 0;
+    int query_words = 0;
+    double minus_ratio = 0;
+};
+
+struct Samples {
+    // Latency of every single operation, nanoseconds.
+    std::vector<double> latencies;
+    // Operations per second of every repetition.
+    std::vector<double> throughputs;
+    // Input bytes per second of every repetition, for file ingestion only.
+    std::vector<double> megabytes_per_second;
+    // Budgeted queries only: the share of results cut short by the budget
+    // and the number of queries that admission control shed.
+    std::optional<double> partial_rate;
+    std::optional<size_t> shed_count;
+};
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const auto value = [arg](std::string_view key) {
+            return std::string(arg.substr(key.size()));
+        };
+        if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg.rfind("--repetitions=", 0) == 0) {
+            options.repetitions = std::max(1, std::stoi(value("--repetitions=")));
+        } else if (arg.rfind("--warmup=", 0) == 0) {
+            options.warmup = std::max(0, std::stoi(value("--warmup=")));
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            options.seed = static_cast<unsigned>(std::stoul(value("--seed=")));
+        } else if (arg.rfind("--zipf=", 0) == 0) {
+            options.zipf_exponent = std::stod(value("--zipf="));
+        } else if (arg.rfind("--workload=", 0) == 0) {
+            options.workload = value("--workload=");
+            if (options.workload != "dictionary" && options.workload != "corpus") {
+                throw std::invalid_argument("Unknown workload " + options.workload);
+            }
+        } else if (arg.rfind("--label=", 0) == 0) {
+            options.label = value("--label=");
+        } else if (arg.rfind("--output=", 0) == 0) {
+            options.output = value("--output=");
+        } else if (arg == "--perf") {
+            options.perf = true;
+        } else if (arg.rfind("--perf=", 0) == 0) {
+            options.perf = true;
+            std::istringstream scopes(value("--perf="));
+            for (std::string scope; std::getline(scopes, scope, ',');) {
+                options.perf_scopes.push_back(scope);
+            }
+        } else {
+            throw std::invalid_argument("Unknown option " + std::string(arg));
+        }
+    }
+    return options;
+}
+
+// Restarts the peak resident set (VmHWM) at the current one, so that every
+// case reports its own peak instead of the largest one so far. False where
+// /proc/self/clear_refs is not writable.
+bool ResetPeakRss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.flush();
+    return static_cast<bool>(clear_refs);
+}
+
+// Peak resident set since the last ResetPeakRss, i.e. since the previous
+// case was reported, setup included. -1 if unknown.
+long PeakRssKb() {
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+    return -1;
+}
+
+double Percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+double Mean(const std::vector<double>& values) {
+    if (values.empty()) {
+        return 0;
+    }
+    return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+}
+
+double StdDev(const std::vector<double>& values) {
+    if (values.size() < 2) {
+        return 0;
+    }
+    const double mean = Mean(values);
+    double sum = 0;
+    for (double value : values) {
+        sum += (value - mean) * (value - mean);
+    }
+    return std::sqrt(sum / (values.size() - 1));
+}
+
+void Report(std::ostream& out, const BenchmarkOptions& options, const BenchmarkCase& test_case, const Samples& samples) {
+    out << "{\"benchmark\":\"" << test_case.name << '"'
+        << ",\"policy\":\"" << test_case.policy << '"'
+        << ",\"corpus_size\":" << test_case.corpus_size
+        << ",\"query_words\":" << test_case.query_words
+        << ",\"minus_ratio\":" << test_case.minus_ratio
+        << ",\"workload\":\"" << options.workload << '"'
+        << ",\"zipf\":" << options.zipf_exponent
+        << ",\"seed\":" << options.seed
+        << ",\"repetitions\":" << samples.throughputs.size()
+        << ",\"operations\":" << samples.latencies.size()
+        << ",\"throughput_ops\":" << Mean(samples.throughputs)
+        << ",\"throughput_stddev\":" << StdDev(samples.throughputs)
+        << ",\"mean_us\":" << Mean(samples.latencies) / 1000
+        << ",\"p50_us\":" << Percentile(samples.latencies, 0.50) / 1000
+        << ",\"p99_us\":" << Percentile(samples.latencies, 0.99) / 1000;
+    if (!samples.megabytes_per_second.empty()) {
+        out << ",\"throughput_mb_s\":" << Mean(samples.megabytes_per_second);
+    }
+    if (samples.partial_rate) {
+        out << ",\"partial_rate\":" << *samples.partial_rate;
+    }
+    if (samples.shed_count) {
+        out << ",\"shed_count\":" << *samples.shed_count;
+    }
+    // Without a reset VmHWM would be the peak of the whole run so far.
+    const long peak_rss_kb = PeakRssKb();
+    out << ",\"peak_rss_kb\":" << (ResetPeakRss() ? peak_rss_kb : -1)
+        << ",\"label\":\"" << options.label << "\"}" << std::endl;
+}
+
+// Index footprint per structure, for capacity planning.
+void ReportMemory(std::ostream& out, const BenchmarkOptions& options, std::string_view name, int corpus_size, const MemoryStats& stats) {
+    out << "{\"benchmark\":\"" << name << '"'
+        << ",\"corpus_size\":" << corpus_size
+        << ",\"workload\":\"" << options.workload << '"'
+        << ",\"zipf\":" << options.zipf_exponent
+        << ",\"seed\":" << options.seed
+        << ",\"total_bytes\":" << stats.total_bytes
+        << ",\"bytes_per_document\":" << (corpus_size > 0 ? stats.total_bytes / corpus_size : 0)
+        << ",\"empty_postings\":" << stats.empty_postings
+        << ",\"removed_postings\":" << stats.removed_postings
+        << ",\"orphaned_word_frequencies\":" << stats.orphaned_word_frequencies
+        << ",\"peak_query_scratch_bytes\":" << stats.peak_query_scratch_bytes;
+    for (const StructureMemory& structure : stats.structures) {
+        out << ",\"" << structure.name << "_bytes\":" << structure.bytes
+            << ",\"" << structure.name << "_elements\":" << structure.elements;
+    }
+    out << ",\"label\":\"" << options.label << "\"}" << std::endl;
+}
+
+// Runs operation(i) for i in [0, count) warmup + repetitions times and
+// records the latency of every timed call.
+template <typename Operation>
+Samples Measure(const BenchmarkOptions& options, size_t count, Operation operation) {
+    Samples samples;
+    samples.latencies.reserve(count * options.repetitions);
+    for (int round = 0; round < options.warmup + options.repetitions; ++round) {
+        const bool timed = round >= options.warmup;
+        const auto round_start = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            const auto start = Clock::now();
+            operation(i);
+            if (timed) {
+                samples.latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+            }
+        }
+        if (timed) {
+            const double seconds = std::chrono::duration<double>(Clock::now() - round_start).count();
+            samples.throughputs.push_back(seconds > 0 ? count / seconds : 0);
+        }
+    }
+    return samples;
+}
+
+class Corpus {
+public:
+    Corpus(const BenchmarkOptions& options, int document_count)
+        : options_(options) {
+        if (options.workload == "corpus") {
+            CorpusOptions corpus_options;
+            corpus_options.seed = options.seed;
+            corpus_options.zipf_exponent = options.zipf_exponent;
+            corpus_options.document_length_median = 70;
+            generator_ = std::make_unique<CorpusGenerator>(corpus_options);
+            stop_words_ = generator_->GetStopWords();
+            documents_.reserve(document_count);
+            generator_->ForEachDocument(0, document_count, [this](const GeneratedDocument& document) {
+                documents_.push_back(document);
+            });
+            return;
+        }
+
+        std::mt19937 generator(options.seed);
+        dictionary_ = GenerateDictionary(generator, 1000, 10);
+        std::sort(dictionary_.begin(), dictionary_.end());
+        dictionary_.erase(std::unique(dictionary_.begin(), dictionary_.end()), dictionary_.end());
+        std::shuffle(dictionary_.begin(), dictionary_.end(), generator);
+        // The most frequent word is the stop word, as in real text.
+        stop_words_ = dictionary_.front();
+        const auto texts = ::GenerateQueries(generator, dictionary_, document_count, 70, 0, options.zipf_exponent);
+        documents_.reserve(texts.size());
+        for (size_t i = 0; i < texts.size(); ++i) {
+            documents_.push_back(GeneratedDocument{static_cast<int>(i), DocumentStatus::ACTUAL, {1, 2, 3}, texts[i]});
+        }
+    }
+
+    const std::vector<GeneratedDocument>& GetDocuments() const {
+        return documents_;
+    }
+
+    const std::string& GetStopWords() const {
+        return stop_words_;
+    }
+
+    std::vector<std::string> GenerateQueries(unsigned seed, int query_count, int query_words, double minus_ratio) const {
+        if (generator_) {
+            QueryLogOptions query_options;
+            query_options.seed = seed;
+            query_options.min_words = query_words;
+            query_options.max_words = query_words;
+            query_options.minus_ratio = minus_ratio;
+            query_options.distinct_query_count = query_count;
+            return QueryLogGenerator(*generator_, query_options).Generate(query_count);
+        }
+        std::mt19937 generator(seed);
+        return ::GenerateQueries(generator, dictionary_, query_count, query_words, minus_ratio, options_.zipf_exponent);
+    }
+
+    void AddDocumentsTo(SearchServer& search_server) const {
+        for (const auto& document : documents_) {
+            search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+    }
+
+private:
+    const BenchmarkOptions& options_;
+    std::unique_ptr<CorpusGenerator> generator_;
+    std::vector<std::string> dictionary_;
+    std::string stop_words_;
+    std::vector<GeneratedDocument> documents_;
+};
+
+void BenchmarkIngest(std::ostream& out, const BenchmarkOptions& options, const Corpus& corpus) {
+    const auto& documents = corpus.GetDocuments();
+    Samples samples;
+    for (int round = 0; round < options.warmup + options.repetitions; ++round) {
+        const bool timed = round >= options.warmup;
+        SearchServer search_server(corpus.GetStopWords());
+        const auto round_start = Clock::now();
+        for (size_t i = 0; i < documents.size(); ++i) {
+            const auto start = Clock::now();
+            search_server.AddDocument(documents[i].id, documents[i].text, documents[i].status, documents[i].ratings);
+            if (timed) {
+                samples.latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+            }
+        }
+        if (timed) {
+            const double seconds = std::chrono::duration<double>(Clock::now() - round_start).count();
+            samples.throughputs.push_back(documents.size() / seconds);
+        }
+    }
+    Report(out, options, {"add_document", "seq", static_cast<int>(documents.size()), 70, 0}, samples);
+}
+
+// Same documents read back from a file through the ingestion pipeline.
+// Latency is per document, measured around AddDocument in the consumer.
+void BenchmarkIngestFile(std::ostream& out, const BenchmarkOptions& options, const Corpus& corpus, const std::string& name, DocumentFileFormat format) {
+    const auto& documents = corpus.GetDocuments();
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / ("search_server_benchmark_" + std::to_string(getpid()));
+    {
+        std::ofstream file(path);
+        DocumentRecord record;
+        for (const auto& document : documents) {
+            record.id = document.id;
+            record.status = document.status;
+            record.ratings = document.ratings;
+            record.text = document.text;
+            WriteDocumentRecord(file, record, format);
+        }
+    }
+
+    IngestOptions ingest_options;
+    ingest_options.format = format;
+    Samples samples;
+    for (int round = 0; round < options.warmup + options.repetitions; ++round) {
+        const bool timed = round >= options.warmup;
+        SearchServer search_server(corpus.GetStopWords());
+        const IngestStats stats = ReadDocumentFile(path.string(), ingest_options, [&](const DocumentRecord& record) {
+            const auto start = Clock::now();
+            search_server.AddDocument(record.id, record.text, record.status, record.ratings);
+            if (timed) {
+                samples.latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+            }
+        });
+        if (timed) {
+            samples.throughputs.push_back(stats.document_count / stats.seconds);
+            samples.megabytes_per_second.push_back(stats.GetMegabytesPerSecond());
+        }
+    }
+    std::filesystem::remove(path);
+    Report(out, options, {name, "seq", static_cast<int>(documents.size()), 70, 0}, samples);
+}
+
+// Logged additions from thread_count writers, whose fsyncs are grouped,
+// then the replay of that log on open. Limited to the first documents,
+// since every addition waits for the disk.
+void BenchmarkDurableIngest(std::ostream& out, const BenchmarkOptions& options, const Corpus& corpus, int thread_count) {
+    const auto& all_documents = corpus.GetDocuments();
+    const size_t document_count = std::min<size_t>(all_documents.size(), 2'000);
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / ("search_server_benchmark_log_" + std::to_string(getpid()));
+    const std::string policy = thread_count > 1 ? "par" : "seq";
+
+    Samples add_samples;
+    Samples replay_samples;
+    std::vector<std::vector<double>> thread_latencies(thread_count);
+    for (int round = 0; round < options.warmup + options.repetitions; ++round) {
+        const bool timed = round >= options.warmup;
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        {
+            DurableSearchServer search_server(directory.string(), corpus.GetStopWords());
+            const auto round_start = Clock::now();
+            std::vector<std::thread> writers;
+            for (int thread = 0; thread < thread_count; ++thread) {
+                writers.emplace_back([&, thread] {
+                    for (size_t i = thread; i < document_count; i += thread_count) {
+                        const auto& document = all_documents[i];
+                        const auto start = Clock::now();
+                        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+                        thread_latencies[thread].push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+                    }
+                });
+            }
+            for (std::thread& writer : writers) {
+                writer.join();
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - round_start).count();
+            for (auto& latencies : thread_latencies) {
+                if (timed) {
+                    add_samples.latencies.insert(add_samples.latencies.end(), latencies.begin(), latencies.end());
+                }
+                latencies.clear();
+            }
+            if (timed) {
+                add_samples.throughputs.push_back(document_count / seconds);
+            }
+        }
+
+        const auto start = Clock::now();
+        const DurableSearchServer search_server(directory.string(), corpus.GetStopWords());
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (timed) {
+            replay_samples.latencies.push_back(seconds * 1e9);
+            replay_samples.throughputs.push_back(search_server.GetReplayedCount() / seconds);
+        }
+    }
+    std::filesystem::remove_all(directory);
+    Report(out, options, {"add_document_logged_" + std::to_string(thread_count), policy, static_cast<int>(document_count), 70, 0}, add_samples);
+    if (thread_count == 1) {
+        Report(out, options, {"replay_log", "seq", static_cast<int>(document_count), 70, 0}, replay_samples);
+    }
+}
+
+// What BenchmarkFind counts of the results.
+struct FindTally {
+    double total_relevance = 0;
+    size_t result_count = 0;
+    size_t partial_count = 0;
+    size_t shed_count = 0;
+};
+
+void AddToTally(FindTally& tally, const std::vector<Document>& documents) {
+    for (const Document& document : documents) {
+        tally.total_relevance += document.relevance;
+    }
+}
+
+void AddToTally(FindTally& tally, const BudgetedDocuments& result) {
+    ++tally.result_count;
+    tally.partial_count += result.is_partial ? 1 : 0;
+    AddToTally(tally, result.documents);
+}
+
+// std::nullopt for a query that admission control shed.
+void AddToTally(FindTally& tally, const std::optional<BudgetedDocuments>& result) {
+    if (result) {
+        AddToTally(tally, *result);
+    } else {
+        ++tally.shed_count;
+    }
+}
+
+// Times find(query) for every query of the set. find returns the documents,
+// BudgetedDocuments, or an optional of them that is empty if the query was
+// shed; the last two add the partial_rate and shed_count columns.
+template <typename Query, typename Find>
+void BenchmarkFind(std::ostream& out, const BenchmarkOptions& options, const BenchmarkCase& test_case, const std::vector<Query>& queries, Find find) {
+    using Result = decltype(find(queries.front()));
+    // The warmup rounds are not reported, like their latencies.
+    const size_t warmup_calls = options.warmup * queries.size();
+    size_t calls = 0;
+    FindTally warmup_tally;
+    FindTally tally;
+    auto samples = Measure(options, queries.size(), [&](size_t i) {
+        AddToTally(calls++ < warmup_calls ? warmup_tally : tally, find(queries[i]));
+    });
+    if constexpr (!std::is_same_v<Result, std::vector<Document>>) {
+        samples.partial_rate = tally.result_count == 0 ? 0.0 : static_cast<double>(tally.partial_count) / tally.result_count;
+    }
+    if constexpr (std::is_same_v<Result, std::optional<BudgetedDocuments>>) {
+        samples.shed_count = tally.shed_count;
+    }
+    Report(out, options, test_case, samples);
+    // Keeps the optimizer from dropping the queries.
+    if (std::isnan(warmup_tally.total_relevance + tally.total_relevance)) {
+        std::cerr << tally.total_relevance << std::endl;
+    }
+}
+
+// Calls load(i) for i = 0, 1, ... on every thread until destroyed, to
+// measure a case while other clients compete with it.
+class BackgroundLoad {
+public:
+    template <typename Load>
+    BackgroundLoad(int thread_count, Load load) {
+        for (int thread = 0; thread < thread_count; ++thread) {
+            threads_.emplace_back([this, load] {
+                for (size_t i = 0; !is_done_.load(std::memory_order_relaxed); ++i) {
+                    load(i);
+                }
+            });
+        }
+    }
+
+    ~BackgroundLoad() {
+        is_done_.store(true, std::memory_order_relaxed);
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    BackgroundLoad(const BackgroundLoad&) = delete;
+    BackgroundLoad& operator=(const BackgroundLoad&) = delete;
+
+private:
+    std::atomic<bool> is_done_{false};
+    std::vector<std::thread> threads_;
+};
+
+// Runs the whole query set as one batch; throughput is in queries per second.
+template <typename Processor>
+void BenchmarkProcessQueries(std::ostream& out, const BenchmarkOptions& options, const SearchServer& search_server, const BenchmarkCase& test_case, const std::vector<std::string>& queries, Processor processor) {
+    size_t total_documents = 0;
+    auto samples = Measure(options, 1, [&](size_t) {
+        for (const auto& documents : processor(search_server, queries)) {
+            total_documents += documents.size();
+        }
+    });
+    for (double& throughput : samples.throughputs) {
+        throughput *= queries.size();
+    }
+    Report(out, options, test_case, samples);
+    if (total_documents == static_cast<size_t>(-1)) {
+        std::cerr << total_documents << std::endl;
+    }
+}
+
+// Whole batches on the worker pool, with or without per-node replicas.
+void BenchmarkNumaProcessQueries(std::ostream& out, const BenchmarkOptions& options, const NumaSearchServer& search_server, const BenchmarkCase& test_case, const std::vector<std::string>& queries) {
+    size_t total_documents = 0;
+    auto samples = Measure(options, 1, [&](size_t) {
+        for (const auto& documents : search_server.ProcessQueries(queries)) {
+            total_documents += documents.size();
+        }
+    });
+    for (double& throughput : samples.throughputs) {
+        throughput *= queries.size();
+    }
+    Report(out, options, test_case, samples);
+    if (total_documents == static_cast<size_t>(-1)) {
+        std::cerr << total_documents << std::endl;
+    }
+}
+
+template <typename ExecutionPolicy>
+void BenchmarkMatch(std::ostream& out, const BenchmarkOptions& options, const SearchServer& search_server, const BenchmarkCase& test_case, const std::vector<std::string>& queries, ExecutionPolicy&& policy) {
+    size_t total_words = 0;
+    const int document_count = search_server.GetDocumentCount();
+    const auto samples = Measure(options, queries.size(), [&](size_t i) {
+        const auto [words, status] = search_server.MatchDocument(policy, queries[i], static_cast<int>(i * 7919 % document_count));
+        total_words += words.size();
+    });
+    Report(out, options, test_case, samples);
+    if (total_words == static_cast<size_t>(-1)) {
+        std::cerr << total_words << std::endl;
+    }
+}
+
+// Matches each query against a batch of 100 documents.
+template <typename ExecutionPolicy>
+void BenchmarkMatchBatch(std::ostream& out, const BenchmarkOptions& options, const SearchServer& search_server, const BenchmarkCase& test_case, const std::vector<std::string>& queries, ExecutionPolicy&& policy) {
+    const int document_count = search_server.GetDocumentCount();
+    std::vector<int> document_ids;
+    for (int i = 0; i < std::min(100, document_count); ++i) {
+        document_ids.push_back(i * 7919 % document_count);
+    }
+    size_t total_words = 0;
+    const auto samples = Measure(options, queries.size(), [&](size_t i) {
+        for (const auto& [words, status] : search_server.MatchDocuments(policy, queries[i], document_ids)) {
+            total_words += words.size();
+        }
+    });
+    Report(out, options, test_case, samples);
+    if (total_words == static_cast<size_t>(-1)) {
+        std::cerr << total_words << std::endl;
+    }
+}
+
+template <typename ExecutionPolicy>
+void BenchmarkRemove(std::ostream& out, const BenchmarkOptions& options, const Corpus& corpus, const std::string& policy_name, ExecutionPolicy&& policy) {
+    const int document_count = corpus.GetDocuments().size();
+    // Every tenth document, so that removals hit a populated index.
+    const int removed_count = std::max(1, document_count / 10);
+    Samples samples;
+    for (int round = 0; round < options.warmup + options.repetitions; ++round) {
+        const bool timed = round >= options.warmup;
+        SearchServer search_server(corpus.GetStopWords());
+        corpus.AddDocumentsTo(search_server);
+        const auto round_start = Clock::now();
+        for (int i = 0; i < removed_count; ++i) {
+            const auto start = Clock::now();
+            search_server.RemoveDocument(policy, i * 10 % document_count);
+            if (timed) {
+                samples.latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+            }
+        }
+        if (timed) {
+            const double seconds = std::chrono::duration<double>(Clock::now() - round_start).count();
+            samples.throughputs.push_back(removed_count / seconds);
+        }
+    }
+    Report(out, options, {"remove_document", policy_name, document_count, 0, 0}, samples);
+}
+
+// Removes nine documents in ten, compactions included, then times one
+// explicit Compact after removing a third, which stays below the automatic
+// threshold.
+void BenchmarkMassRemove(std::ostream& out, const BenchmarkOptions& options, const Corpus& corpus) {
+    const int document_count = corpus.GetDocuments().size();
+    Samples remove_samples;
+    Samples compact_samples;
+    for (int round = 0; round < options.warmup + options.repetitions; ++round) {
+        const bool timed = round >= options.warmup;
+        {
+            SearchServer search_server(corpus.GetStopWords());
+            corpus.AddDocumentsTo(search_server);
+            int removed_count = 0;
+            const auto round_start = Clock::now();
+            for (int document_id = 0; document_id < document_count; ++document_id) {
+                if (document_id % 10 == 0) {
+                    continue;
+                }
+                const auto start = Clock::now();
+                search_server.RemoveDocument(document_id);
+                if (timed) {
+                    remove_samples.latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+                }
+                ++removed_count;
+            }
+            if (timed) {
+                const double seconds = std::chrono::duration<double>(Clock::now() - round_start).count();
+                remove_samples.throughputs.push_back(removed_count / seconds);
+            }
+        }
+
+        SearchServer search_server(corpus.GetStopWords());
+        corpus.AddDocumentsTo(search_server);
+        int removed_count = 0;
+        for (int document_id = 0; document_id < document_count; document_id += 3) {
+            search_server.RemoveDocument(document_id);
+            ++removed_count;
+        }
+        const auto start = Clock::now();
+        search_server.Compact();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (timed) {
+            compact_samples.latencies.push_back(seconds * 1e9);
+            compact_samples.throughputs.push_back(removed_count / seconds);
+        }
+    }
+    Report(out, options, {"remove_document_mass", "seq", document_count, 0, 0}, remove_samples);
+    Report(out, options, {"compact", "par", document_count, 0, 0}, compact_samples);
+}
+
+void BenchmarkRemoveDuplicates(std::ostream& out, const BenchmarkOptions& options, const Corpus& corpus) {
+    const auto& documents = corpus.GetDocuments();
+    Samples samples;
+    // RemoveDuplicates reports every duplicate on std::cout.
+    std::ostringstream sink;
+    auto* const cout_buffer = std::cout.rdbuf(sink.rdbuf());
+    for (int round = 0; round < options.warmup + options.repetitions; ++round) {
+        SearchServer search_server(corpus.GetStopWords());
+        corpus.AddDocumentsTo(search_server);
+        // Every fifth document gets a duplicate.
+        for (size_t i = 0; i < documents.size(); i += 5) {
+            search_server.AddDocument(documents.size() + i, documents[i].text, documents[i].status, documents[i].ratings);
+        }
+        const auto start = Clock::now();
+        RemoveDuplicates(search_server);
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (round >= options.warmup) {
+            samples.latencies.push_back(seconds * 1e9);
+            samples.throughputs.push_back(documents.size() / seconds);
+        }
+        sink.str({});
+    }
+    std::cout.rdbuf(cout_buffer);
+    Report(out, options, {"remove_duplicates", "seq", static_cast<int>(documents.size()), 0, 0}, samples);
+}
+
+void RunBenchmarks(std::ostream& out, const BenchmarkOptions& options) {
+    const std::vector<int> corpus_sizes = options.quick ? std::vector<int>{1'000, 10'000} : std::vector<int>{1'000, 10'000, 50'000};
+    const std::vector<int> query_lengths = options.quick ? std::vector<int>{3, 70} : std::vector<int>{3, 10, 70};
+    const std::vector<double> minus_ratios = options.quick ? std::vector<double>{0, 0.2} : std::vector<double>{0, 0.1, 0.3};
+    const int query_count = options.quick ? 100 : 500;
+    ResetPeakRss();
+
+    for (int corpus_size : corpus_sizes) {
+        const Corpus corpus(options, corpus_size);
+        BenchmarkIngest(out, options, corpus);
+        BenchmarkIngestFile(out, options, corpus, "ingest_file_tsv", DocumentFileFormat::TSV);
+        BenchmarkIngestFile(out, options, corpus, "ingest_file_jsonl", DocumentFileFormat::JSONL);
+        BenchmarkDurableIngest(out, options, corpus, 1);
+        BenchmarkDurableIngest(out, options, corpus, 4);
+
+        SearchServer search_server(corpus.GetStopWords());
+        corpus.AddDocumentsTo(search_server);
+        ReportMemory(out, options, "memory", corpus_size, search_server.GetMemoryStats());
+        ShardedSearchServer sharded_server(corpus.GetStopWords(), 4);
+        for (const auto& document : corpus.GetDocuments()) {
+            sharded_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+        const std::string serialized_index = SerializeIndex(search_server, 1);
+        const FlatIndex flat_index(serialized_index);
+        const FrozenSearchServer frozen_server = [&corpus] {
+            SearchServer search_server(corpus.GetStopWords());
+            corpus.AddDocumentsTo(search_server);
+            return Freeze(std::move(search_server));
+        }();
+        ReportMemory(out, options, "memory_frozen", corpus_size, frozen_server.GetMemoryStats());
+        const NumaSearchServer numa_server(frozen_server, {true, 0});
+        const NumaSearchServer pool_server(frozen_server, {false, 0});
+        QueryBudget posting_budget;
+        posting_budget.max_postings = 10'000;
+        unsigned query_seed = options.seed + corpus_size;
+        for (int query_words : query_lengths) {
+            for (double minus_ratio : minus_ratios) {
+                const auto queries = corpus.GenerateQueries(query_seed++, query_count, query_words, minus_ratio);
+                BenchmarkFind(out, options, {"find_top_documents", "seq", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return search_server.FindTopDocuments(std::execution::seq, query); });
+                BenchmarkFind(out, options, {"find_top_documents", "par", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return search_server.FindTopDocuments(std::execution::par, query); });
+                // With an unlimited budget this measures the accounting
+                // overhead alone.
+                BenchmarkFind(out, options, {"find_top_documents_budgeted", "seq", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return search_server.FindTopDocumentsWithin(query, QueryBudget{}); });
+                BenchmarkFind(out, options, {"find_top_documents_budget_10k_postings", "seq", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return search_server.FindTopDocumentsWithin(query, posting_budget); });
+                {
+                    // Room for two budgeted queries in flight, while three
+                    // other clients send the same queries.
+                    AdmissionController admission(2 * posting_budget.max_postings, 4);
+                    const auto find_admitted = [&](const std::string& query) -> std::optional<BudgetedDocuments> {
+                        const auto ticket = admission.Admit(search_server.EstimateQueryCost(query), std::chrono::milliseconds(1));
+                        if (!ticket) {
+                            return std::nullopt;
+                        }
+                        return search_server.FindTopDocumentsWithin(query, posting_budget);
+                    };
+                    const BackgroundLoad clients(3, [&](size_t i) { find_admitted(queries[i % queries.size()]); });
+                    BenchmarkFind(out, options, {"find_top_documents_admitted", "seq", corpus_size, query_words, minus_ratio}, queries, find_admitted);
+                }
+                // The specialized AnyDocument and WithStatus kernels against
+                // lambdas that the server cannot see through.
+                BenchmarkFind(out, options, {"find_top_documents_status_lambda", "seq", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return search_server.FindTopDocuments(query, [](int, DocumentStatus status, int) { return status == DocumentStatus::ACTUAL; }); });
+                BenchmarkFind(out, options, {"find_top_documents_any", "seq", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return search_server.FindTopDocuments(query, AnyDocument{}); });
+                BenchmarkFind(out, options, {"find_top_documents_any_lambda", "seq", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return search_server.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; }); });
+                // Prepared outside of the measurement, as an application that
+                // reuses query templates would do.
+                std::vector<SearchServer::PreparedQuery> prepared_queries;
+                for (const std::string& query : queries) {
+                    prepared_queries.push_back(search_server.PrepareQuery(query));
+                }
+                BenchmarkFind(out, options, {"find_top_documents_prepared", "seq", corpus_size, query_words, minus_ratio}, prepared_queries,
+                    [&](const SearchServer::PreparedQuery& query) { return search_server.FindTopDocuments(query); });
+                BenchmarkProcessQueries(out, options, search_server, {"process_queries", "par", corpus_size, query_words, minus_ratio}, queries, ProcessQueries);
+                BenchmarkProcessQueries(out, options, search_server, {"process_queries_batched", "par", corpus_size, query_words, minus_ratio}, queries, ProcessQueriesBatched);
+                BenchmarkFind(out, options, {"find_top_documents_sharded_4", "par", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return sharded_server.FindTopDocuments(query); });
+                // The serialized layout that serving processes map read-only.
+                BenchmarkFind(out, options, {"find_top_documents_flat", "seq", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return flat_index.FindTopDocuments(query); });
+                BenchmarkFind(out, options, {"find_top_documents_frozen", "seq", corpus_size, query_words, minus_ratio}, queries,
+                    [&](const std::string& query) { return frozen_server.FindTopDocuments(query); });
+                BenchmarkNumaProcessQueries(out, options, numa_server, {"process_queries_numa", "par", corpus_size, query_words, minus_ratio}, queries);
+                BenchmarkNumaProcessQueries(out, options, pool_server, {"process_queries_numa_off", "par", corpus_size, query_words, minus_ratio}, queries);
+                BenchmarkMatch(out, options, search_server, {"match_document", "seq", corpus_size, query_words, minus_ratio}, queries, std::execution::seq);
+                BenchmarkMatch(out, options, search_server, {"match_document", "par", corpus_size, query_words, minus_ratio}, queries, std::execution::par);
+                BenchmarkMatchBatch(out, options, search_server, {"match_documents_batch", "seq", corpus_size, query_words, minus_ratio}, queries, std::execution::seq);
+                BenchmarkMatchBatch(out, options, search_server, {"match_documents_batch", "par", corpus_size, query_words, minus_ratio}, queries, std::execution::par);
+            }
+        }
+
+        // Autocomplete: one prefix term, query_words holds the prefix length.
+        // The client-side variant sends the expansion as a query of words.
+        for (int prefix_length : {1, 2}) {
+            std::vector<std::string> prefix_queries;
+            std::vector<std::string> client_queries;
+            for (const std::string& word : corpus.GenerateQueries(query_seed++, query_count, 1, 0)) {
+                const std::string prefix = word.substr(0, prefix_length) + '*';
+                std::string client_query;
+                for (std::string_view expanded_word : search_server.PrepareQuery(prefix).GetPlusWords()) {
+                    client_query += (client_query.empty() ? "" : " ") + std::string(expanded_word);
+                }
+                if (!client_query.empty()) {
+                    prefix_queries.push_back(prefix);
+                    client_queries.push_back(std::move(client_query));
+                }
+            }
+            BenchmarkFind(out, options, {"find_top_documents_prefix", "seq", corpus_size, prefix_length, 0}, prefix_queries,
+                [&](const std::string& query) { return search_server.FindTopDocuments(query); });
+            BenchmarkFind(out, options, {"find_top_documents_prefix_client", "seq", corpus_size, prefix_length, 0}, client_queries,
+                [&](const std::string& query) { return search_server.FindTopDocuments(query); });
+            BenchmarkFind(out, options, {"find_top_documents_prefix_frozen", "seq", corpus_size, prefix_length, 0}, prefix_queries,
+                [&](const std::string& query) { return frozen_server.FindTopDocuments(query); });
+        }
+
+        BenchmarkRemove(out, options, corpus, "seq", std::execution::seq);
+        BenchmarkRemove(out, options, corpus, "par", std::execution::par);
+        BenchmarkMassRemove(out, options, corpus);
+
+        // RemoveDuplicates compares every pair of documents.
+        if (corpus_size <= 1'000) {
+            BenchmarkRemoveDuplicates(out, options, corpus);
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const BenchmarkOptions options = ParseOptions(argc, argv);
+        if (options.perf) {
+            EnablePerfProfiling(options.perf_scopes);
+        }
+        if (options.output.empty()) {
+            RunBenchmarks(std::cout, options);
+        } else {
+            std::ofstream out(options.output);
+            RunBenchmarks(out, options);
+        }
+        if (options.perf) {
+            std::cerr << GetPerfProfile();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+}
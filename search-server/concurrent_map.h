@@ -1,14 +1,13 @@
+#pragma once
+
+#include <cstdint>
 #include <cstdlib>
 #include <map>
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-#include "log_duration.h"
-#include "test_framework.h"
-
-using namespace std::string_literals;
-
 template <typename Key, typename Value>
 class ConcurrentMap {
 private:
@@ -18,7 +17,7 @@ private:
     };
 
 public:
-    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"s);
+    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys");
 
     struct Access {
         std::lock_guard<std::mutex> guard;
@@ -0,0 +1,228 @@
+#include "corpus_generator.h"
+
+#include "search_server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+uint64_t MixSeed(uint64_t seed, uint64_t value) {
+    SplitMix64 random(seed ^ (value * 0xD1B54A32D192ED03ull));
+    return random();
+}
+
+std::vector<double> ZipfWeights(size_t n, double exponent) {
+    std::vector<double> weights(n);
+    for (size_t k = 0; k < n; ++k) {
+        weights[k] = 1.0 / std::pow(static_cast<double>(k + 1), exponent);
+    }
+    return weights;
+}
+
+// Frequent words are short (Zipf's law of abbreviation).
+std::string GenerateVocabularyWord(SplitMix64& random, size_t rank) {
+    const int base_length = 2 + static_cast<int>(std::log2(rank + 1.0) / 1.5);
+    const int length = std::clamp(base_length + static_cast<int>(random.NextBelow(5)) - 2, 1, 16);
+    std::string word(length, ' ');
+    for (char& c : word) {
+        c = static_cast<char>('a' + random.NextBelow(26));
+    }
+    return word;
+}
+
+}  // namespace
+
+AliasTable::AliasTable(const std::vector<double>& weights)
+    : probabilities_(weights.size())
+    , aliases_(weights.size()) {
+    using namespace std::string_literals;
+
+    const size_t n = weights.size();
+    double total = 0;
+    for (double weight : weights) {
+        total += weight;
+    }
+    if (n == 0 || !(total > 0)) {
+        throw std::invalid_argument("Alias table needs positive weights"s);
+    }
+
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < n; ++i) {
+        scaled[i] = weights[i] * n / total;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    while (!small.empty() && !large.empty()) {
+        const uint32_t less = small.back();
+        small.pop_back();
+        const uint32_t more = large.back();
+        probabilities_[less] = scaled[less];
+        aliases_[less] = more;
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    for (uint32_t i : large) {
+        probabilities_[i] = 1.0;
+        aliases_[i] = i;
+    }
+    for (uint32_t i : small) {
+        probabilities_[i] = 1.0;
+        aliases_[i] = i;
+    }
+}
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions& options)
+    : options_(options) {
+    using namespace std::string_literals;
+
+    if (options_.vocabulary_size <= 0 || options_.stop_word_count < 0 || options_.stop_word_count >= options_.vocabulary_size) {
+        throw std::invalid_argument("Invalid vocabulary size"s);
+    }
+    if (options_.min_document_length < 1 || options_.max_document_length < options_.min_document_length) {
+        throw std::invalid_argument("Invalid document length bounds"s);
+    }
+
+    SplitMix64 random(MixSeed(options_.seed, 0));
+    std::unordered_set<std::string> known_words;
+    vocabulary_.reserve(options_.vocabulary_size);
+    while (vocabulary_.size() < static_cast<size_t>(options_.vocabulary_size)) {
+        std::string word = GenerateVocabularyWord(random, vocabulary_.size());
+        if (known_words.insert(word).second) {
+            vocabulary_.push_back(std::move(word));
+        }
+    }
+
+    word_ranks_ = AliasTable(ZipfWeights(vocabulary_.size(), options_.zipf_exponent));
+    statuses_ = AliasTable({options_.status_weights.begin(), options_.status_weights.end()});
+}
+
+const CorpusOptions& CorpusGenerator::GetOptions() const {
+    return options_;
+}
+
+const std::vector<std::string>& CorpusGenerator::GetVocabulary() const {
+    return vocabulary_;
+}
+
+std::string CorpusGenerator::GetStopWords() const {
+    std::string stop_words;
+    for (int i = 0; i < options_.stop_word_count; ++i) {
+        if (!stop_words.empty()) {
+            stop_words.push_back(' ');
+        }
+        stop_words += vocabulary_[i];
+    }
+    return stop_words;
+}
+
+size_t CorpusGenerator::SampleWordRank(SplitMix64& random) const {
+    return word_ranks_(random);
+}
+
+void CorpusGenerator::GenerateDocument(int document_id, GeneratedDocument& document) const {
+    // Offset by one: stream 0 is the vocabulary.
+    SplitMix64 random(MixSeed(options_.seed, static_cast<uint64_t>(document_id) + 1));
+
+    document.id = document_id;
+    document.status = static_cast<DocumentStatus>(statuses_(random));
+
+    document.ratings.clear();
+    const size_t ratings_count = random.NextBelow(options_.max_ratings_count + 1);
+    for (size_t i = 0; i < ratings_count; ++i) {
+        document.ratings.push_back(static_cast<int>(random.NextBelow(21)) - 10);
+    }
+
+    // Box-Muller, using only the generator above to stay deterministic.
+    const double u1 = 1.0 - random.NextDouble();
+    const double u2 = random.NextDouble();
+    const double normal = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+    const double length = options_.document_length_median * std::exp(options_.document_length_sigma * normal);
+    const int word_count = std::clamp(static_cast<int>(std::lround(length)), options_.min_document_length, options_.max_document_length);
+
+    document.text.clear();
+    for (int i = 0; i < word_count; ++i) {
+        if (i > 0) {
+            document.text.push_back(' ');
+        }
+        document.text += vocabulary_[word_ranks_(random)];
+    }
+}
+
+GeneratedDocument CorpusGenerator::GenerateDocument(int document_id) const {
+    GeneratedDocument document;
+    GenerateDocument(document_id, document);
+    return document;
+}
+
+void CorpusGenerator::AddDocumentsTo(SearchServer& search_server, int first_id, int count) const {
+    ForEachDocument(first_id, count, [&search_server](const GeneratedDocument& document) {
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    });
+}
+
+void CorpusGenerator::WriteDocuments(std::ostream& out, int first_id, int count, DocumentFileFormat format) const {
+    DocumentRecord record;
+    ForEachDocument(first_id, count, [&out, &record, format](const GeneratedDocument& document) {
+        record.id = document.id;
+        record.status = document.status;
+        record.ratings.assign(document.ratings.begin(), document.ratings.end());
+        record.text = document.text;
+        WriteDocumentRecord(out, record, format);
+    });
+}
+
+QueryLogGenerator::QueryLogGenerator(const CorpusGenerator& corpus, const QueryLogOptions& options)
+    : corpus_(corpus)
+    , options_(options)
+    , random_(MixSeed(options.seed, 0)) {
+    using namespace std::string_literals;
+
+    if (options_.min_words < 1 || options_.max_words < options_.min_words) {
+        throw std::invalid_argument("Invalid query length bounds"s);
+    }
+    if (options_.distinct_query_count > 0) {
+        popularity_ = AliasTable(ZipfWeights(options_.distinct_query_count, options_.repeat_exponent));
+    }
+}
+
+std::string QueryLogGenerator::GenerateQuery(uint64_t query_index) const {
+    SplitMix64 random(MixSeed(options_.seed, query_index + 1));
+    const auto& vocabulary = corpus_.GetVocabulary();
+    const int word_count = options_.min_words + static_cast<int>(random.NextBelow(options_.max_words - options_.min_words + 1));
+
+    std::string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (i > 0) {
+            query.push_back(' ');
+        }
+        if (random.NextDouble() < options_.minus_ratio) {
+            query.push_back('-');
+        }
+        query += vocabulary[corpus_.SampleWordRank(random)];
+    }
+    return query;
+}
+
+std::string QueryLogGenerator::Next() {
+    if (options_.distinct_query_count > 0) {
+        return GenerateQuery(popularity_(random_));
+    }
+    return GenerateQuery(generated_count_++);
+}
+
+std::vector<std::string> QueryLogGenerator::Generate(size_t count) {
+    std::vector<std::string> queries;
+    queries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        queries.push_back(Next());
+    }
+    return queries;
+}
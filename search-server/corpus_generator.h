@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "document_file.h"
+
+class SearchServer;
+
+// Small deterministic generator. Unlike std::mt19937 + std distributions,
+// its output does not depend on the standard library implementation.
+class SplitMix64 {
+public:
+    using result_type = uint64_t;
+
+    explicit SplitMix64(uint64_t seed)
+        : state_(seed) {
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return UINT64_MAX;
+    }
+
+    result_type operator()() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1).
+    double NextDouble() {
+        return ((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    // Uniform in [0, bound).
+    uint64_t NextBelow(uint64_t bound) {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>((*this)()) * bound) >> 64);
+    }
+
+private:
+    uint64_t state_;
+};
+
+// Walker's alias method: O(1) sampling from a fixed discrete distribution.
+class AliasTable {
+public:
+    AliasTable() = default;
+
+    explicit AliasTable(const std::vector<double>& weights);
+
+    size_t operator()(SplitMix64& random) const {
+        const size_t column = random.NextBelow(probabilities_.size());
+        return random.NextDouble() < probabilities_[column] ? column : aliases_[column];
+    }
+
+    size_t size() const {
+        return probabilities_.size();
+    }
+
+private:
+    std::vector<double> probabilities_;
+    std::vector<uint32_t> aliases_;
+};
+
+struct CorpusOptions {
+    uint64_t seed = 42;
+    int vocabulary_size = 50'000;
+    // Word ranks follow P(k) ~ 1 / k^zipf_exponent, close to 1 for natural text.
+    double zipf_exponent = 1.0;
+    // The most frequent words are the stop words, as in real text.
+    int stop_word_count = 30;
+    // Document lengths in words are log-normal.
+    double document_length_median = 100;
+    double document_length_sigma = 0.7;
+    int min_document_length = 1;
+    int max_document_length = 2'000;
+    int max_ratings_count = 5;
+    // Weights of ACTUAL, IRRELEVANT, BANNED and REMOVED.
+    std::array<double, 4> status_weights = {0.90, 0.05, 0.03, 0.02};
+};
+
+struct GeneratedDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+// Synthetic corpus with a Zipf-distributed vocabulary. Document i depends
+// only on the seed and i, so any range of documents can be regenerated,
+// generated in parallel or streamed without keeping the corpus in memory.
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusOptions& options = {});
+
+    const CorpusOptions& GetOptions() const;
+
+    // Words ordered by frequency rank, the most frequent first.
+    const std::vector<std::string>& GetVocabulary() const;
+
+    // Space-separated stop-word list for the SearchServer constructor.
+    std::string GetStopWords() const;
+
+    // Reuses the buffers of document, so a streaming loop does not allocate.
+    void GenerateDocument(int document_id, GeneratedDocument& document) const;
+    GeneratedDocument GenerateDocument(int document_id) const;
+
+    template <typename Consumer>
+    void ForEachDocument(int first_id, int count, Consumer consumer) const;
+
+    void AddDocumentsTo(SearchServer& search_server, int first_id, int count) const;
+
+    // One document per line in the format read by ReadDocumentFile.
+    void WriteDocuments(std::ostream& out, int first_id, int count, DocumentFileFormat format = DocumentFileFormat::TSV) const;
+
+    size_t SampleWordRank(SplitMix64& random) const;
+
+private:
+    CorpusOptions options_;
+    std::vector<std::string> vocabulary_;
+    AliasTable word_ranks_;
+    AliasTable statuses_;
+};
+
+template <typename Consumer>
+void CorpusGenerator::ForEachDocument(int first_id, int count, Consumer consumer) const {
+    GeneratedDocument document;
+    for (int id = first_id; id < first_id + count; ++id) {
+        GenerateDocument(id, document);
+        consumer(static_cast<const GeneratedDocument&>(document));
+    }
+}
+
+struct QueryLogOptions {
+    uint64_t seed = 7;
+    int min_words = 1;
+    int max_words = 8;
+    double minus_ratio = 0.1;
+    // Queries are drawn from a pool of distinct queries whose popularity is
+    // Zipf-distributed, so popular queries repeat. 0 makes every query unique.
+    int distinct_query_count = 10'000;
+    double repeat_exponent = 0.9;
+};
+
+class QueryLogGenerator {
+public:
+    QueryLogGenerator(const CorpusGenerator& corpus, const QueryLogOptions& options = {});
+
+    // Distinct query number query_index of the pool.
+    std::string GenerateQuery(uint64_t query_index) const;
+
+    std::string Next();
+
+    std::vector<std::string> Generate(size_t count);
+
+private:
+    const CorpusGenerator& corpus_;
+    QueryLogOptions options_;
+    AliasTable popularity_;
+    SplitMix64 random_;
+    uint64_t generated_count_ = 0;
+};
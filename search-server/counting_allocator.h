@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// Live heap usage of one data structure: bytes requested from the
+// allocator (without malloc overhead) and number of blocks.
+struct AllocationCounter {
+    std::atomic<size_t> bytes = 0;
+    std::atomic<size_t> blocks = 0;
+    // Largest value bytes has reached.
+    std::atomic<size_t> peak_bytes = 0;
+};
+
+// std::allocator that reports every allocation to an AllocationCounter.
+// A null counter disables the accounting.
+template <typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit CountingAllocator(AllocationCounter* counter) noexcept
+        : counter_(counter) {
+    }
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept
+        : counter_(other.GetCounter()) {
+    }
+
+    T* allocate(size_t n) {
+        T* result = std::allocator<T>().allocate(n);
+        if (counter_) {
+            const size_t bytes = counter_->bytes.fetch_add(n * sizeof(T), std::memory_order_relaxed) + n * sizeof(T);
+            counter_->blocks.fetch_add(1, std::memory_order_relaxed);
+            size_t peak_bytes = counter_->peak_bytes.load(std::memory_order_relaxed);
+            while (bytes > peak_bytes && !counter_->peak_bytes.compare_exchange_weak(peak_bytes, bytes, std::memory_order_relaxed)) {
+            }
+        }
+        return result;
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (counter_) {
+            counter_->bytes.fetch_sub(n * sizeof(T), std::memory_order_relaxed);
+            counter_->blocks.fetch_sub(1, std::memory_order_relaxed);
+        }
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    AllocationCounter* GetCounter() const noexcept {
+        return counter_;
+    }
+
+private:
+    AllocationCounter* counter_;
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs) noexcept {
+    return lhs.GetCounter() == rhs.GetCounter();
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs) noexcept {
+    return !(lhs == rhs);
+}
@@ -1,11 +1,45 @@
 #include "document.h"
 
+#include <stdexcept>
+#include <string>
+
 Document::Document(int id, double relevance, int rating)
         : id(id)
         , relevance(relevance)
         , rating(rating) {
 }
     
+std::ostream& operator<<(std::ostream& out, DocumentStatus status) {
+    using namespace std::string_literals;
+    switch (status) {
+        case DocumentStatus::ACTUAL:
+            return out << "ACTUAL"s;
+        case DocumentStatus::IRRELEVANT:
+            return out << "IRRELEVANT"s;
+        case DocumentStatus::BANNED:
+            return out << "BANNED"s;
+        case DocumentStatus::REMOVED:
+            return out << "REMOVED"s;
+    }
+    return out << static_cast<int>(status);
+}
+
+DocumentStatus ParseDocumentStatus(std::string_view text) {
+    using namespace std::string_literals;
+    if (text == "ACTUAL") {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT") {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED") {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED") {
+        return DocumentStatus::REMOVED;
+    }
+    throw std::invalid_argument("Unknown document status "s + std::string(text));
+}
 
 std::ostream& operator<<(std::ostream& out, const Document& document) {
     using namespace std::string_literals; 
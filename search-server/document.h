@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <string_view>
 
 enum class DocumentStatus {
     ACTUAL,
@@ -19,6 +20,12 @@ struct Document {
     int rating = 0;
 };
 
+std::ostream& operator<<(std::ostream& out, DocumentStatus status);
+
+// Inverse of operator<<: "ACTUAL", "IRRELEVANT", "BANNED" or "REMOVED".
+// Throws std::invalid_argument for anything else.
+DocumentStatus ParseDocumentStatus(std::string_view text);
+
 std::ostream& operator<<(std::ostream& out, const Document& document);
 
 void PrintDocument(const Document& document);
\ No newline at end of file
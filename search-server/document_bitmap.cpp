@@ -0,0 +1,107 @@
+#include "document_bitmap.h"
+
+DocumentBitmap::DocumentBitmap(AllocationCounter* counter)
+    : containers_(CountingAllocator<Container>(counter)) {
+}
+
+void DocumentBitmap::Add(int document_id) {
+    const uint16_t key = GetKey(document_id);
+    const uint16_t low = GetLow(document_id);
+
+    // Ids usually arrive in increasing order, so the last group is tried first.
+    auto it = !containers_.empty() && containers_.back().key == key
+        ? containers_.end() - 1
+        : std::lower_bound(containers_.begin(), containers_.end(), key,
+              [](const Container& container, uint16_t key) {
+                  return container.key < key;
+              });
+    if (it == containers_.end() || it->key != key) {
+        AllocationCounter* counter = containers_.get_allocator().GetCounter();
+        it = containers_.insert(it, Container{key, 0, Values(CountingAllocator<uint16_t>(counter)), Words(CountingAllocator<uint64_t>(counter))});
+    }
+
+    Container& container = *it;
+    if (!container.words.empty()) {
+        uint64_t& word = container.words[low >> 6];
+        const uint64_t bit = uint64_t{1} << (low & 63);
+        container.count += (word & bit) == 0;
+        word |= bit;
+        return;
+    }
+
+    auto& values = container.values;
+    const auto position = !values.empty() && values.back() < low ? values.end() : std::lower_bound(values.begin(), values.end(), low);
+    if (position != values.end() && *position == low) {
+        return;
+    }
+    values.insert(position, low);
+    ++container.count;
+
+    if (values.size() > MAX_ARRAY_SIZE) {
+        container.words.assign(BITMAP_WORD_COUNT, 0);
+        for (uint16_t value : values) {
+            container.words[value >> 6] |= uint64_t{1} << (value & 63);
+        }
+        values.clear();
+        values.shrink_to_fit();
+    }
+}
+
+void DocumentBitmap::Remove(int document_id) {
+    const uint16_t key = GetKey(document_id);
+    const uint16_t low = GetLow(document_id);
+
+    const auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+        [](const Container& container, uint16_t key) {
+            return container.key < key;
+        });
+    if (it == containers_.end() || it->key != key) {
+        return;
+    }
+
+    Container& container = *it;
+    if (container.words.empty()) {
+        const auto position = std::lower_bound(container.values.begin(), container.values.end(), low);
+        if (position == container.values.end() || *position != low) {
+            return;
+        }
+        container.values.erase(position);
+    } else {
+        uint64_t& word = container.words[low >> 6];
+        const uint64_t bit = uint64_t{1} << (low & 63);
+        if ((word & bit) == 0) {
+            return;
+        }
+        word &= ~bit;
+        if (container.count - 1 <= MAX_ARRAY_SIZE) {
+            for (size_t i = 0; i < BITMAP_WORD_COUNT; ++i) {
+                for (uint64_t bits = container.words[i]; bits != 0; bits &= bits - 1) {
+                    container.values.push_back(static_cast<uint16_t>(i * 64 + __builtin_ctzll(bits)));
+                }
+            }
+            container.words.clear();
+            container.words.shrink_to_fit();
+        }
+    }
+
+    if (--container.count == 0) {
+        containers_.erase(it);
+    }
+}
+
+void DocumentBitmap::Clear() {
+    containers_.clear();
+    containers_.shrink_to_fit();
+}
+
+size_t DocumentBitmap::GetCount() const {
+    size_t count = 0;
+    for (const Container& container : containers_) {
+        count += container.count;
+    }
+    return count;
+}
+
+bool DocumentBitmap::IsEmpty() const {
+    return containers_.empty();
+}
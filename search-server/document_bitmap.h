@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "counting_allocator.h"
+
+// Compressed set of document ids in the spirit of Roaring bitmaps. Ids are
+// grouped by their upper 16 bits; a group is a sorted array of the lower
+// halves while it has at most 4096 ids and a 65536-bit bitmap above that,
+// so that both sparse and dense sets stay small and Contains is one binary
+// search over the groups plus one probe.
+class DocumentBitmap {
+public:
+    // A non-null counter receives the heap usage of the bitmap.
+    explicit DocumentBitmap(AllocationCounter* counter = nullptr);
+
+    void Add(int document_id);
+    void Remove(int document_id);
+    // Removes every id and releases the memory.
+    void Clear();
+
+    bool Contains(int document_id) const {
+        const Container* container = FindContainer(GetKey(document_id));
+        if (!container) {
+            return false;
+        }
+        const uint16_t low = GetLow(document_id);
+        if (container->words.empty()) {
+            return std::binary_search(container->values.begin(), container->values.end(), low);
+        }
+        return (container->words[low >> 6] >> (low & 63)) & 1;
+    }
+
+    size_t GetCount() const;
+    bool IsEmpty() const;
+
+private:
+    static constexpr size_t MAX_ARRAY_SIZE = 4096;
+    static constexpr size_t BITMAP_WORD_COUNT = 65536 / 64;
+
+    using Values = std::vector<uint16_t, CountingAllocator<uint16_t>>;
+    using Words = std::vector<uint64_t, CountingAllocator<uint64_t>>;
+
+    struct Container {
+        uint16_t key;
+        uint32_t count;
+        // Array form: sorted lower halves. Unused in bitmap form.
+        Values values;
+        // Bitmap form: BITMAP_WORD_COUNT words. Empty in array form.
+        Words words;
+    };
+
+    // Sorted by key.
+    std::vector<Container, CountingAllocator<Container>> containers_;
+
+    static uint16_t GetKey(int document_id) {
+        return static_cast<uint16_t>(static_cast<uint32_t>(document_id) >> 16);
+    }
+
+    static uint16_t GetLow(int document_id) {
+        return static_cast<uint16_t>(static_cast<uint32_t>(document_id) & 0xFFFF);
+    }
+
+    const Container* FindContainer(uint16_t key) const {
+        const auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+            [](const Container& container, uint16_t key) {
+                return container.key < key;
+            });
+        return it != containers_.end() && it->key == key ? &*it : nullptr;
+    }
+};
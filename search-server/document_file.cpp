@@ -0,0 +1,675 @@
+#include "document_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_io.h"
+#include "search_server.h"
+
+namespace {
+
+// Read-only private mapping of a whole file.
+class FileMapping {
+public:
+    explicit FileMapping(const std::string& path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw MakeSystemError("Cannot open", path);
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0) {
+            const auto error = MakeSystemError("Cannot stat", path);
+            close(fd);
+            throw error;
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0) {
+            address_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address_ == MAP_FAILED) {
+                const auto error = MakeSystemError("Cannot map", path);
+                close(fd);
+                throw error;
+            }
+            madvise(address_, size_, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+
+    ~FileMapping() {
+        if (size_ > 0) {
+            munmap(address_, size_);
+        }
+    }
+
+    std::string_view GetData() const {
+        if (size_ == 0) {
+            return {};
+        }
+        return {static_cast<const char*>(address_), size_};
+    }
+
+    // Drops the whole pages before offset from memory. The mapping stays
+    // valid: a dropped page is read from the file again if touched.
+    void Release(size_t offset) {
+        static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t end = offset / page_size * page_size;
+        if (end > released_) {
+            madvise(static_cast<char*>(address_) + released_, end - released_, MADV_DONTNEED);
+            released_ = end;
+        }
+    }
+
+private:
+    void* address_ = nullptr;
+    size_t size_ = 0;
+    size_t released_ = 0;
+};
+
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : capacity_(capacity) {
+    }
+
+    // Blocks while the queue is full. False if the queue has been closed.
+    bool Push(T item) {
+        std::unique_lock lock(mutex_);
+        not_full_.wait(lock, [this] {
+            return closed_ || items_.size() < capacity_;
+        });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is empty. Nothing once it is closed and drained.
+    std::optional<T> Pop() {
+        std::unique_lock lock(mutex_);
+        not_empty_.wait(lock, [this] {
+            return closed_ || !items_.empty();
+        });
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return item;
+    }
+
+    void Close() {
+        std::lock_guard guard(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::deque<T> items_;
+    size_t capacity_;
+    bool closed_ = false;
+};
+
+struct ParsedRecord {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    size_t ratings_begin = 0;
+    size_t ratings_end = 0;
+    // Offset into the file, or into RecordBatch::decoded_text if decoded.
+    size_t text_begin = 0;
+    size_t text_size = 0;
+    bool is_text_decoded = false;
+};
+
+// Batches are recycled between the threads, so their buffers stop growing
+// after the first few batches.
+struct RecordBatch {
+    std::vector<ParsedRecord> records;
+    std::vector<int> ratings;
+    std::string decoded_text;
+    // File offset just past the last line of the batch.
+    size_t end_offset = 0;
+
+    void Clear() {
+        records.clear();
+        ratings.clear();
+        decoded_text.clear();
+    }
+};
+
+int ParseInteger(std::string_view text, std::string_view what) {
+    using namespace std::string_literals;
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || error != std::errc() || end != text.data() + text.size()) {
+        throw std::invalid_argument("Invalid "s + std::string(what) + " "s + std::string(text));
+    }
+    return value;
+}
+
+void ParseTsvLine(std::string_view data, std::string_view line, ParsedRecord& record, RecordBatch& batch) {
+    using namespace std::string_literals;
+
+    std::string_view fields[3];
+    for (std::string_view& field : fields) {
+        const size_t tab = line.find('\t');
+        if (tab == std::string_view::npos) {
+            throw std::invalid_argument("Expected id, status, ratings and text separated by tabs"s);
+        }
+        field = line.substr(0, tab);
+        line.remove_prefix(tab + 1);
+    }
+
+    record.id = ParseInteger(fields[0], "document id");
+    record.status = ParseDocumentStatus(fields[1]);
+    record.ratings_begin = batch.ratings.size();
+    for (std::string_view ratings = fields[2]; !ratings.empty();) {
+        const size_t comma = ratings.find(',');
+        batch.ratings.push_back(ParseInteger(ratings.substr(0, comma), "rating"));
+        ratings.remove_prefix(comma == std::string_view::npos ? ratings.size() : comma + 1);
+    }
+    record.ratings_end = batch.ratings.size();
+    record.text_begin = static_cast<size_t>(line.data() - data.data());
+    record.text_size = line.size();
+}
+
+// Parser of one flat JSON object. Only the subset needed for document
+// records is interpreted; other values are validated loosely and skipped.
+class JsonRecordParser {
+public:
+    JsonRecordParser(std::string_view data, std::string_view line, std::string& scratch)
+        : data_(data)
+        , line_(line)
+        , scratch_(scratch) {
+    }
+
+    void Parse(ParsedRecord& record, RecordBatch& batch) {
+        using namespace std::string_literals;
+
+        bool has_id = false;
+        bool has_text = false;
+        record.ratings_begin = record.ratings_end = batch.ratings.size();
+
+        Expect('{');
+        SkipSpaces();
+        if (Peek() != '}') {
+            while (true) {
+                scratch_.clear();
+                const std::string_view key = ParseString(scratch_);
+                Expect(':');
+                if (key == "id") {
+                    record.id = ParseNumber("document id");
+                    has_id = true;
+                } else if (key == "status") {
+                    record.status = ParseStatus();
+                } else if (key == "ratings") {
+                    ParseRatings(record, batch);
+                } else if (key == "text") {
+                    ParseText(record, batch);
+                    has_text = true;
+                } else {
+                    SkipValue();
+                }
+                SkipSpaces();
+                if (Peek() != ',') {
+                    break;
+                }
+                ++position_;
+            }
+        }
+        Expect('}');
+        SkipSpaces();
+        if (position_ != line_.size()) {
+            throw std::invalid_argument("Unexpected characters after the object"s);
+        }
+        if (!has_id) {
+            throw std::invalid_argument("Document id is missing"s);
+        }
+        if (!has_text) {
+            throw std::invalid_argument("Document text is missing"s);
+        }
+    }
+
+private:
+    std::string_view data_;
+    std::string_view line_;
+    size_t position_ = 0;
+    std::string& scratch_;
+
+    // '\0' at the end of the line.
+    char Peek() const {
+        return position_ < line_.size() ? line_[position_] : '\0';
+    }
+
+    void SkipSpaces() {
+        while (position_ < line_.size() && (line_[position_] == ' ' || line_[position_] == '\t')) {
+            ++position_;
+        }
+    }
+
+    void Expect(char c) {
+        using namespace std::string_literals;
+        SkipSpaces();
+        if (Peek() != c) {
+            throw std::invalid_argument("Expected '"s + c + "' at column "s + std::to_string(position_ + 1));
+        }
+        ++position_;
+    }
+
+    int ParseNumber(std::string_view what) {
+        SkipSpaces();
+        const size_t begin = position_;
+        while (position_ < line_.size() && (line_[position_] == '-' || (line_[position_] >= '0' && line_[position_] <= '9'))) {
+            ++position_;
+        }
+        return ParseInteger(line_.substr(begin, position_ - begin), what);
+    }
+
+    DocumentStatus ParseStatus() {
+        using namespace std::string_literals;
+        SkipSpaces();
+        if (Peek() == '"') {
+            scratch_.clear();
+            return ParseDocumentStatus(ParseString(scratch_));
+        }
+        const int status = ParseNumber("document status");
+        if (status < 0 || status > static_cast<int>(DocumentStatus::REMOVED)) {
+            throw std::invalid_argument("Invalid document status "s + std::to_string(status));
+        }
+        return static_cast<DocumentStatus>(status);
+    }
+
+    void ParseRatings(ParsedRecord& record, RecordBatch& batch) {
+        record.ratings_begin = batch.ratings.size();
+        Expect('[');
+        SkipSpaces();
+        if (Peek() != ']') {
+            while (true) {
+                batch.ratings.push_back(ParseNumber("rating"));
+                SkipSpaces();
+                if (Peek() != ',') {
+                    break;
+                }
+                ++position_;
+            }
+        }
+        Expect(']');
+        record.ratings_end = batch.ratings.size();
+    }
+
+    void ParseText(ParsedRecord& record, RecordBatch& batch) {
+        const size_t decoded_begin = batch.decoded_text.size();
+        const std::string_view text = ParseString(batch.decoded_text);
+        record.is_text_decoded = batch.decoded_text.size() != decoded_begin;
+        record.text_begin = record.is_text_decoded ? decoded_begin : static_cast<size_t>(text.data() - data_.data());
+        record.text_size = text.size();
+    }
+
+    // Without escapes the result points into the line. Otherwise the decoded
+    // string is appended to buffer and the result points there.
+    std::string_view ParseString(std::string& buffer) {
+        using namespace std::string_literals;
+
+        Expect('"');
+        const size_t begin = position_;
+        while (position_ < line_.size() && line_[position_] != '"' && line_[position_] != '\\') {
+            ++position_;
+        }
+        if (Peek() == '"') {
+            ++position_;
+            return line_.substr(begin, position_ - begin - 1);
+        }
+
+        const size_t decoded_begin = buffer.size();
+        buffer.append(line_.substr(begin, position_ - begin));
+        while (true) {
+            const char c = Peek();
+            if (c == '\0' && position_ == line_.size()) {
+                throw std::invalid_argument("Unterminated string"s);
+            }
+            ++position_;
+            if (c == '"') {
+                break;
+            }
+            if (c != '\\') {
+                buffer.push_back(c);
+                continue;
+            }
+            const char escape = Peek();
+            ++position_;
+            switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    buffer.push_back(escape);
+                    break;
+                case 'b':
+                    buffer.push_back('\b');
+                    break;
+                case 'f':
+                    buffer.push_back('\f');
+                    break;
+                case 'n':
+                    buffer.push_back('\n');
+                    break;
+                case 'r':
+                    buffer.push_back('\r');
+                    break;
+                case 't':
+                    buffer.push_back('\t');
+                    break;
+                case 'u':
+                    AppendUtf8(buffer, ParseCodePoint());
+                    break;
+                default:
+                    throw std::invalid_argument("Invalid escape sequence at column "s + std::to_string(position_));
+            }
+        }
+        return std::string_view(buffer).substr(decoded_begin);
+    }
+
+    uint32_t ParseHexQuad() {
+        using namespace std::string_literals;
+        uint32_t value = 0;
+        const std::string_view digits = line_.substr(position_, 4);
+        const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value, 16);
+        if (digits.size() != 4 || error != std::errc() || end != digits.data() + digits.size()) {
+            throw std::invalid_argument("Invalid \\u escape at column "s + std::to_string(position_));
+        }
+        position_ += 4;
+        return value;
+    }
+
+    // Reads the digits after "\u", joining a surrogate pair.
+    uint32_t ParseCodePoint() {
+        using namespace std::string_literals;
+        const uint32_t high = ParseHexQuad();
+        if (high < 0xD800 || high > 0xDFFF) {
+            return high;
+        }
+        if (high > 0xDBFF || line_.substr(position_, 2) != "\\u") {
+            throw std::invalid_argument("Unpaired surrogate at column "s + std::to_string(position_));
+        }
+        position_ += 2;
+        const uint32_t low = ParseHexQuad();
+        if (low < 0xDC00 || low > 0xDFFF) {
+            throw std::invalid_argument("Unpaired surrogate at column "s + std::to_string(position_));
+        }
+        return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    static void AppendUtf8(std::string& buffer, uint32_t code_point) {
+        if (code_point < 0x80) {
+            buffer.push_back(static_cast<char>(code_point));
+        } else if (code_point < 0x800) {
+            buffer.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+            buffer.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else if (code_point < 0x10000) {
+            buffer.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+            buffer.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            buffer.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else {
+            buffer.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+            buffer.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+            buffer.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            buffer.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+    }
+
+    void SkipValue() {
+        using namespace std::string_literals;
+        SkipSpaces();
+        const char c = Peek();
+        if (c == '"') {
+            scratch_.clear();
+            ParseString(scratch_);
+        } else if (c == '{' || c == '[') {
+            const char close = c == '{' ? '}' : ']';
+            ++position_;
+            SkipSpaces();
+            if (Peek() != close) {
+                while (true) {
+                    if (close == '}') {
+                        scratch_.clear();
+                        ParseString(scratch_);
+                        Expect(':');
+                    }
+                    SkipValue();
+                    SkipSpaces();
+                    if (Peek() != ',') {
+                        break;
+                    }
+                    ++position_;
+                }
+            }
+            Expect(close);
+        } else {
+            // Number, true, false or null.
+            const size_t begin = position_;
+            while (position_ < line_.size() && std::strchr(",]} \t", line_[position_]) == nullptr) {
+                ++position_;
+            }
+            if (position_ == begin) {
+                throw std::invalid_argument("Expected a value at column "s + std::to_string(position_ + 1));
+            }
+        }
+    }
+};
+
+class DocumentFileParser {
+public:
+    DocumentFileParser(std::string_view data, DocumentFileFormat format)
+        : data_(data)
+        , format_(format) {
+    }
+
+    // Fills the batch with up to batch_size records. False at the end of data.
+    // A malformed line ends the batch before it and is reported by the next
+    // call, so that every record above it is still delivered.
+    bool Fill(RecordBatch& batch, size_t batch_size) {
+        using namespace std::string_literals;
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        batch.Clear();
+        while (batch.records.size() < batch_size && position_ < data_.size()) {
+            size_t line_end = data_.find('\n', position_);
+            if (line_end == std::string_view::npos) {
+                line_end = data_.size();
+            }
+            std::string_view line = data_.substr(position_, line_end - position_);
+            position_ = std::min(line_end + 1, data_.size());
+            ++line_number_;
+
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (line.empty()) {
+                continue;
+            }
+
+            ParsedRecord& record = batch.records.emplace_back();
+            try {
+                if (format_ == DocumentFileFormat::TSV) {
+                    ParseTsvLine(data_, line, record, batch);
+                } else {
+                    JsonRecordParser(data_, line, scratch_).Parse(record, batch);
+                }
+            } catch (const std::invalid_argument& error) {
+                batch.records.pop_back();
+                error_ = std::make_exception_ptr(std::invalid_argument("Line "s + std::to_string(line_number_) + ": "s + error.what()));
+                if (batch.records.empty()) {
+                    std::rethrow_exception(error_);
+                }
+                break;
+            }
+        }
+        batch.end_offset = position_;
+        return !batch.records.empty();
+    }
+
+private:
+    std::string_view data_;
+    DocumentFileFormat format_;
+    size_t position_ = 0;
+    size_t line_number_ = 0;
+    std::string scratch_;
+    std::exception_ptr error_;
+};
+
+} // namespace
+
+void WriteDocumentRecord(std::ostream& out, const DocumentRecord& record, DocumentFileFormat format) {
+    if (format == DocumentFileFormat::TSV) {
+        out << record.id << '\t' << record.status << '\t';
+        for (size_t i = 0; i < record.ratings.size(); ++i) {
+            if (i > 0) {
+                out << ',';
+            }
+            out << record.ratings[i];
+        }
+        out << '\t' << record.text << '\n';
+        return;
+    }
+
+    out << "{\"id\": " << record.id << ", \"status\": \"" << record.status << "\", \"ratings\": [";
+    for (size_t i = 0; i < record.ratings.size(); ++i) {
+        if (i > 0) {
+            out << ", ";
+        }
+        out << record.ratings[i];
+    }
+    out << "], \"text\": \"";
+    for (const char c : record.text) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\r':
+                out << "\\r";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    const char* digits = "0123456789abcdef";
+                    out << "\\u00" << digits[c >> 4] << digits[c & 0xF];
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << "\"}\n";
+}
+
+double IngestStats::GetMegabytesPerSecond() const {
+    return seconds > 0.0 ? static_cast<double>(byte_count) / 1e6 / seconds : 0.0;
+}
+
+IngestStats ReadDocumentFile(const std::string& path, const IngestOptions& options,
+                             const std::function<void(const DocumentRecord&)>& consumer) {
+    using namespace std::string_literals;
+
+    if (options.batch_size == 0 || options.queue_capacity == 0) {
+        throw std::invalid_argument("Batch size and queue capacity must be positive"s);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    FileMapping mapping(path);
+    const std::string_view data = mapping.GetData();
+
+    // One batch more than the queue holds is being parsed and one is being consumed.
+    const size_t batch_count = options.queue_capacity + 2;
+    BoundedQueue<std::unique_ptr<RecordBatch>> parsed_batches(options.queue_capacity);
+    BoundedQueue<std::unique_ptr<RecordBatch>> free_batches(batch_count);
+    for (size_t i = 0; i < batch_count; ++i) {
+        free_batches.Push(std::make_unique<RecordBatch>());
+    }
+
+    std::exception_ptr parser_error;
+    std::thread parser_thread([&] {
+        try {
+            DocumentFileParser parser(data, options.format);
+            while (auto batch = free_batches.Pop()) {
+                if (!parser.Fill(**batch, options.batch_size) || !parsed_batches.Push(std::move(*batch))) {
+                    break;
+                }
+            }
+        } catch (...) {
+            parser_error = std::current_exception();
+        }
+        parsed_batches.Close();
+    });
+
+    IngestStats stats;
+    try {
+        DocumentRecord record;
+        while (auto batch = parsed_batches.Pop()) {
+            const RecordBatch& records = **batch;
+            for (const ParsedRecord& parsed : records.records) {
+                record.id = parsed.id;
+                record.status = parsed.status;
+                record.ratings.assign(records.ratings.begin() + parsed.ratings_begin, records.ratings.begin() + parsed.ratings_end);
+                record.text = (parsed.is_text_decoded ? std::string_view(records.decoded_text) : data).substr(parsed.text_begin, parsed.text_size);
+                consumer(record);
+            }
+            stats.document_count += records.records.size();
+            mapping.Release(records.end_offset);
+            free_batches.Push(std::move(*batch));
+        }
+    } catch (...) {
+        parsed_batches.Close();
+        free_batches.Close();
+        parser_thread.join();
+        throw;
+    }
+    parser_thread.join();
+    if (parser_error) {
+        std::rethrow_exception(parser_error);
+    }
+
+    stats.byte_count = data.size();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+IngestStats IngestDocuments(SearchServer& search_server, const std::string& path, const IngestOptions& options) {
+    return ReadDocumentFile(path, options, [&search_server](const DocumentRecord& record) {
+        search_server.AddDocument(record.id, record.text, record.status, record.ratings);
+    });
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+class SearchServer;
+
+// Line-oriented corpus files. TSV lines are
+//     id <TAB> status <TAB> comma-separated ratings <TAB> text
+// and JSONL lines are flat objects such as
+//     {"id": 1, "status": "ACTUAL", "ratings": [1, 2], "text": "..."}
+// where status may also be given as a number and defaults to ACTUAL,
+// ratings default to none and unknown keys are ignored. Empty lines are
+// skipped in both formats.
+enum class DocumentFileFormat {
+    TSV,
+    JSONL,
+};
+
+struct DocumentRecord {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    // Points into the mapped file or into a decode buffer, valid only
+    // while the record is being consumed.
+    std::string_view text;
+};
+
+void WriteDocumentRecord(std::ostream& out, const DocumentRecord& record, DocumentFileFormat format);
+
+struct IngestOptions {
+    DocumentFileFormat format = DocumentFileFormat::TSV;
+    // Records handed from the parsing thread to the consumer at once.
+    size_t batch_size = 1024;
+    // Parsed batches that may wait for the consumer. Together with
+    // batch_size this bounds the memory of the pipeline.
+    size_t queue_capacity = 4;
+};
+
+struct IngestStats {
+    size_t document_count = 0;
+    size_t byte_count = 0;
+    double seconds = 0.0;
+
+    double GetMegabytesPerSecond() const;
+};
+
+// Maps the file and parses it on a separate thread while the calling thread
+// consumes the records in file order. Text is not copied unless a JSON
+// escape has to be decoded, and consumed pages are dropped from the mapping,
+// so files larger than memory are read in constant space.
+// Throws std::runtime_error if the file cannot be read and
+// std::invalid_argument with the line number for a malformed line; the
+// records before that line have been consumed by then.
+// Exceptions of the consumer stop the parser and are rethrown.
+IngestStats ReadDocumentFile(const std::string& path, const IngestOptions& options,
+                             const std::function<void(const DocumentRecord&)>& consumer);
+
+// Adds every document of the file to the server.
+IngestStats IngestDocuments(SearchServer& search_server, const std::string& path, const IngestOptions& options = {});
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <type_traits>
+
+#include "document.h"
+
+// Filters that FindTopDocuments recognizes at compile time. Both are also
+// ordinary (document_id, status, rating) predicates, so they can be passed
+// wherever a lambda is accepted.
+
+// Accepts every document.
+struct AnyDocument {
+    bool operator()(int, DocumentStatus, int) const {
+        return true;
+    }
+};
+
+// Accepts the documents of one status.
+struct WithStatus {
+    DocumentStatus status;
+
+    bool operator()(int, DocumentStatus document_status, int) const {
+        return document_status == status;
+    }
+};
+
+template <typename DocumentPredicate>
+struct DocumentFilterTraits {
+    static constexpr bool is_any_document = false;
+    static constexpr bool is_status_only = false;
+};
+
+template <>
+struct DocumentFilterTraits<AnyDocument> {
+    static constexpr bool is_any_document = true;
+    static constexpr bool is_status_only = false;
+};
+
+template <>
+struct DocumentFilterTraits<WithStatus> {
+    static constexpr bool is_any_document = false;
+    static constexpr bool is_status_only = true;
+};
+
+template <typename DocumentPredicate>
+using DocumentFilterTraitsOf = DocumentFilterTraits<std::decay_t<DocumentPredicate>>;
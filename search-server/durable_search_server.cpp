@@ -0,0 +1,139 @@
+#include "durable_search_server.h"
+
+#include <exception>
+#include <stdexcept>
+
+namespace {
+
+std::string GetSnapshotPath(const std::string& directory) {
+    using namespace std::string_literals;
+    return directory + "/snapshot"s;
+}
+
+std::string GetLogPath(const std::string& directory) {
+    using namespace std::string_literals;
+    return directory + "/log"s;
+}
+
+LoadedSnapshot OpenSnapshot(const std::string& directory, std::string_view stop_words_text) {
+    const std::string path = GetSnapshotPath(directory);
+    if (auto snapshot = LoadSnapshot(path)) {
+        return std::move(*snapshot);
+    }
+    // The stop words have to be durable before the first mutation is.
+    LoadedSnapshot snapshot{SearchServer(stop_words_text), 0};
+    SaveSnapshot(snapshot.search_server, 0, path);
+    return snapshot;
+}
+
+} // namespace
+
+DurableSearchServer::DurableSearchServer(const std::string& directory, std::string_view stop_words_text)
+    : directory_(directory)
+    , snapshot_(OpenSnapshot(directory, stop_words_text))
+    , log_(GetLogPath(directory)) {
+    SearchServer& search_server = snapshot_.search_server;
+    replayed_count_ = log_.Replay(snapshot_.sequence, [&search_server](const Mutation& mutation) {
+        if (mutation.type == MutationType::ADD_DOCUMENT) {
+            search_server.AddDocument(mutation.document_id, mutation.text, mutation.status, mutation.ratings);
+        } else {
+            search_server.RemoveDocument(mutation.document_id);
+        }
+    });
+    applied_sequence_ = log_.GetLastSequence();
+}
+
+void DurableSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    using namespace std::string_literals;
+
+    std::unique_lock lock(mutex_);
+    // A rejected document throws before anything is logged.
+    if (document_id < 0 || WillHaveDocument(document_id)) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    snapshot_.search_server.CheckDocument(document, status);
+    const uint64_t sequence = log_.AppendAddDocument(document_id, document, status, ratings);
+    pending_documents_[document_id] = {true, sequence};
+    Commit(lock, document_id, sequence, [=, &ratings](SearchServer& search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    std::unique_lock lock(mutex_);
+    if (!WillHaveDocument(document_id)) {
+        return;
+    }
+    const uint64_t sequence = log_.AppendRemoveDocument(document_id);
+    pending_documents_[document_id] = {false, sequence};
+    Commit(lock, document_id, sequence, [document_id](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+    });
+}
+
+bool DurableSearchServer::WillHaveDocument(int document_id) const {
+    const auto it = pending_documents_.find(document_id);
+    return it != pending_documents_.end() ? it->second.first : snapshot_.search_server.HasDocument(document_id);
+}
+
+void DurableSearchServer::Commit(std::unique_lock<std::mutex>& lock, int document_id, uint64_t sequence, const std::function<void(SearchServer&)>& apply) {
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+        log_.Sync(sequence);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    lock.lock();
+
+    // Records fail from the first unwritten one on, so skipping a failed
+    // mutation never leaves a later one applied without it.
+    applied_.wait(lock, [this, sequence] {
+        return applied_sequence_ + 1 == sequence;
+    });
+    if (!error) {
+        try {
+            apply(snapshot_.search_server);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    applied_sequence_ = sequence;
+    if (const auto it = pending_documents_.find(document_id); it != pending_documents_.end() && it->second.second == sequence) {
+        pending_documents_.erase(it);
+    }
+    applied_.notify_all();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void DurableSearchServer::SaveSnapshot() {
+    std::unique_lock lock(mutex_);
+    // The snapshot replaces the log, so it must hold every synced record.
+    applied_.wait(lock, [this] {
+        return applied_sequence_ == log_.GetLastSequence();
+    });
+    const uint64_t sequence = log_.GetLastSequence();
+    // A crash between the two steps is harmless: replay skips the records
+    // that the snapshot already holds.
+    ::SaveSnapshot(snapshot_.search_server, sequence, GetSnapshotPath(directory_));
+    log_.Truncate(sequence);
+    snapshot_.sequence = sequence;
+}
+
+const SearchServer& DurableSearchServer::GetSearchServer() const {
+    return snapshot_.search_server;
+}
+
+uint64_t DurableSearchServer::GetSequence() const {
+    return log_.GetLastSequence();
+}
+
+size_t DurableSearchServer::GetReplayedCount() const {
+    return replayed_count_;
+}
+
+const MutationLog& DurableSearchServer::GetLog() const {
+    return log_;
+}
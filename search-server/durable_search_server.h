@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "mutation_log.h"
+#include "search_server.h"
+#include "snapshot.h"
+
+// Search server kept in a directory as a snapshot plus a mutation log.
+// A mutation is validated, logged and synced, and only then applied, so an
+// acknowledged mutation survives a crash and a mutation that throws is not
+// visible; mutations from several threads share fsyncs and are applied in
+// log order. Opening the directory loads the snapshot and replays the
+// log on top of it. SaveSnapshot folds the log into a new snapshot and
+// empties it, which bounds the time of the next start.
+class DurableSearchServer {
+public:
+    // The directory must exist. Without a snapshot in it an empty server
+    // with the given stop words is created; otherwise the stop words of the
+    // snapshot are used.
+    DurableSearchServer(const std::string& directory, std::string_view stop_words_text);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // Unknown ids are ignored and not logged.
+    void RemoveDocument(int document_id);
+
+    // Waits for the mutations in flight to be applied first.
+    void SaveSnapshot();
+
+    // Searches must not run concurrently with mutations.
+    const SearchServer& GetSearchServer() const;
+
+    // Sequence number of the last mutation.
+    uint64_t GetSequence() const;
+    // Records replayed from the log when the directory was opened.
+    size_t GetReplayedCount() const;
+    const MutationLog& GetLog() const;
+
+private:
+    std::string directory_;
+    LoadedSnapshot snapshot_;
+    MutationLog log_;
+    size_t replayed_count_ = 0;
+    // Keeps the order of the log equal to the order of application.
+    std::mutex mutex_;
+    std::condition_variable applied_;
+    // Sequence of the last mutation applied, or dropped because its record
+    // was not written.
+    uint64_t applied_sequence_ = 0;
+    // Documents with logged mutations that are not applied yet: whether the
+    // document exists after them, and the sequence of the last one.
+    std::unordered_map<int, std::pair<bool, uint64_t>> pending_documents_;
+
+    // Whether the document exists once the pending mutations are applied.
+    bool WillHaveDocument(int document_id) const;
+    // Syncs the mutation just logged and entered in pending_documents_, and
+    // applies it after the mutations logged before it. Rethrows a failed
+    // sync without applying.
+    void Commit(std::unique_lock<std::mutex>& lock, int document_id, uint64_t sequence, const std::function<void(SearchServer&)>& apply);
+};
@@ -0,0 +1,107 @@
+#include "file_io.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+std::runtime_error MakeSystemError(const std::string& what, const std::string& path) {
+    using namespace std::string_literals;
+    return std::runtime_error(what + " "s + path + ": "s + std::strerror(errno));
+}
+
+void WriteAll(int fd, std::string_view data, const std::string& path) {
+    while (!data.empty()) {
+        const ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw MakeSystemError("Cannot write", path);
+        }
+        data.remove_prefix(written);
+    }
+}
+
+std::optional<std::string> ReadFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return std::nullopt;
+        }
+        throw MakeSystemError("Cannot open", path);
+    }
+    std::string data;
+    char buffer[1 << 16];
+    while (true) {
+        const ssize_t size = read(fd, buffer, sizeof(buffer));
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            const auto error = MakeSystemError("Cannot read", path);
+            close(fd);
+            throw error;
+        }
+        if (size == 0) {
+            break;
+        }
+        data.append(buffer, size);
+    }
+    close(fd);
+    return data;
+}
+
+void WriteFile(const std::string& path, std::string_view data) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw MakeSystemError("Cannot create", path);
+    }
+    try {
+        WriteAll(fd, data, path);
+        if (fsync(fd) != 0) {
+            throw MakeSystemError("Cannot sync", path);
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+void RenameFile(const std::string& from, const std::string& to) {
+    if (std::rename(from.c_str(), to.c_str()) != 0) {
+        throw MakeSystemError("Cannot rename", from);
+    }
+}
+
+void SyncDirectory(const std::string& directory) {
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+uint32_t ComputeCrc32(std::string_view data, uint32_t crc) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (const char c : data) {
+        crc = table[(crc ^ static_cast<unsigned char>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Error for a failed system call on path, with the text of errno.
+std::runtime_error MakeSystemError(const std::string& what, const std::string& path);
+
+// Writes the whole file and flushes it to disk, so that once it is renamed
+// into place the name never refers to partial data.
+void WriteFile(const std::string& path, std::string_view data);
+
+void RenameFile(const std::string& from, const std::string& to);
+
+// Makes renames and unlinks in the directory durable.
+void SyncDirectory(const std::string& directory);
+
+// Whole contents of the file, nothing if it does not exist.
+std::optional<std::string> ReadFile(const std::string& path);
+
+// Writes all of data to the descriptor, retrying short writes.
+void WriteAll(int fd, std::string_view data, const std::string& path);
+
+// CRC-32 (IEEE) of data, continuing from crc.
+uint32_t ComputeCrc32(std::string_view data, uint32_t crc = 0);
+
+// Appends the bytes of a trivially copyable value in host byte order.
+template <typename T>
+void AppendValue(std::string& out, T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Reads a value written by AppendValue from the front of data. False if
+// data is too short.
+template <typename T>
+bool ReadValue(std::string_view& data, T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (data.size() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, data.data(), sizeof(value));
+    data.remove_prefix(sizeof(value));
+    return true;
+}
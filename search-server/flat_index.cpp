@@ -0,0 +1,437 @@
+#include "flat_index.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "perfect_hash.h"
+
+namespace {
+
+const char FLAT_INDEX_MAGIC[8] = {'S', 'S', 'I', 'N', 'D', 'E', 'X', '\0'};
+const uint32_t FLAT_INDEX_VERSION = 2;
+
+// Appends sections aligned to 8 bytes, so that every array can be read in
+// place once the whole buffer is 8-byte aligned (mmap is page-aligned).
+class SectionWriter {
+public:
+    explicit SectionWriter(size_t header_size)
+        : data_(header_size, '\0') {
+    }
+
+    template <typename T>
+    uint64_t Append(const std::vector<T>& items) {
+        return Append(std::string_view(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T)));
+    }
+
+    uint64_t Append(std::string_view bytes) {
+        const uint64_t offset = data_.size();
+        data_.append(bytes);
+        data_.resize((data_.size() + 7) & ~size_t{7}, '\0');
+        return offset;
+    }
+
+    std::string& GetData() {
+        return data_;
+    }
+
+private:
+    std::string data_;
+};
+
+template <typename T>
+const T* GetSection(std::string_view data, uint64_t offset, uint64_t count) {
+    using namespace std::string_literals;
+
+    if (offset % alignof(T) != 0 || offset > data.size() || count > (data.size() - offset) / sizeof(T)) {
+        throw std::invalid_argument("Flat index section is out of bounds"s);
+    }
+    return reinterpret_cast<const T*>(data.data() + offset);
+}
+
+// Offsets of count items that start at 0 and never decrease. The last one
+// is the size of the section they point into.
+bool AreOffsetsValid(const uint64_t* offsets, uint64_t count) {
+    return offsets[0] == 0 && std::is_sorted(offsets, offsets + count + 1);
+}
+
+struct RelevanceScratch {
+    enum State : uint8_t {
+        UNTOUCHED,
+        MATCHED,
+        EXCLUDED,
+    };
+
+    std::vector<double> relevance;
+    std::vector<uint8_t> states;
+    std::vector<uint32_t> touched;
+    std::vector<std::pair<uint32_t, double>> matched;
+};
+
+} // namespace
+
+std::string SerializeIndex(const SearchServer& search_server, uint64_t generation) {
+    FlatIndexHeader header{};
+    std::memcpy(header.magic, FLAT_INDEX_MAGIC, sizeof(header.magic));
+    header.version = FLAT_INDEX_VERSION;
+    header.generation = generation;
+
+    SectionWriter writer(sizeof(FlatIndexHeader));
+
+    std::vector<uint64_t> stop_word_offsets{0};
+    std::string stop_word_chars;
+    for (const std::string& stop_word : search_server.stop_words_) {
+        stop_word_chars += stop_word;
+        stop_word_offsets.push_back(stop_word_chars.size());
+    }
+    header.stop_word_count = search_server.stop_words_.size();
+    header.stop_word_offsets = writer.Append(stop_word_offsets);
+    header.stop_word_chars = writer.Append(stop_word_chars);
+
+    std::vector<int32_t> document_ids;
+    std::vector<int32_t> document_ratings;
+    std::vector<uint8_t> document_statuses;
+    for (const auto& [document_id, document_data] : search_server.documents_) {
+        document_ids.push_back(document_id);
+        document_ratings.push_back(document_data.rating);
+        document_statuses.push_back(static_cast<uint8_t>(document_data.status));
+    }
+    const auto get_document_index = [&document_ids](int document_id) {
+        return static_cast<uint32_t>(std::lower_bound(document_ids.begin(), document_ids.end(), document_id) - document_ids.begin());
+    };
+
+    std::vector<uint64_t> term_offsets{0};
+    std::string term_chars;
+    std::vector<std::string_view> terms;
+    std::vector<double> term_inverse_document_freqs;
+    std::vector<uint64_t> posting_offsets{0};
+    std::vector<uint32_t> posting_documents;
+    std::vector<double> posting_term_freqs;
+    std::vector<std::vector<uint32_t>> terms_by_document(document_ids.size());
+
+    // Postings of removed documents are not serialized, nor are terms
+    // that only removed documents have.
+    for (const auto& [word, posting_list] : search_server.word_to_document_freqs_) {
+        if (posting_list.document_count == 0) {
+            continue;
+        }
+        const uint32_t term = static_cast<uint32_t>(term_inverse_document_freqs.size());
+        term_chars += word;
+        term_offsets.push_back(term_chars.size());
+        terms.push_back(word);
+        term_inverse_document_freqs.push_back(log(search_server.GetDocumentCount() * 1.0 / posting_list.document_count));
+        for (const auto [document_id, term_freq] : posting_list.postings) {
+            if (search_server.removed_documents_.Contains(document_id)) {
+                continue;
+            }
+            const uint32_t document = get_document_index(document_id);
+            posting_documents.push_back(document);
+            posting_term_freqs.push_back(term_freq);
+            terms_by_document[document].push_back(term);
+        }
+        posting_offsets.push_back(posting_documents.size());
+    }
+
+    std::vector<uint64_t> document_term_offsets{0};
+    std::vector<uint32_t> document_terms;
+    document_terms.reserve(posting_documents.size());
+    for (const auto& terms : terms_by_document) {
+        document_terms.insert(document_terms.end(), terms.begin(), terms.end());
+        document_term_offsets.push_back(document_terms.size());
+    }
+
+    header.document_count = document_ids.size();
+    header.term_count = term_inverse_document_freqs.size();
+    header.posting_count = posting_documents.size();
+    header.term_offsets = writer.Append(term_offsets);
+    header.term_chars = writer.Append(term_chars);
+    const PerfectHash term_hash = BuildPerfectHash(terms);
+    header.term_hash_salt = term_hash.salt;
+    header.term_hash_bucket_count = term_hash.seeds.size();
+    header.term_hash_seeds = writer.Append(term_hash.seeds);
+    header.term_hash_slots = writer.Append(term_hash.slots);
+    header.term_inverse_document_freqs = writer.Append(term_inverse_document_freqs);
+    header.posting_offsets = writer.Append(posting_offsets);
+    header.posting_documents = writer.Append(posting_documents);
+    header.posting_term_freqs = writer.Append(posting_term_freqs);
+    header.document_ids = writer.Append(document_ids);
+    header.document_ratings = writer.Append(document_ratings);
+    header.document_statuses = writer.Append(document_statuses);
+    header.document_term_offsets = writer.Append(document_term_offsets);
+    header.document_terms = writer.Append(document_terms);
+
+    std::string& data = writer.GetData();
+    header.total_size = data.size();
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    return std::move(data);
+}
+
+FlatIndex::FlatIndex(std::string_view data) {
+    using namespace std::string_literals;
+
+    if (reinterpret_cast<uintptr_t>(data.data()) % alignof(FlatIndexHeader) != 0) {
+        throw std::invalid_argument("Flat index is not aligned"s);
+    }
+    header_ = GetSection<FlatIndexHeader>(data, 0, 1);
+    if (std::memcmp(header_->magic, FLAT_INDEX_MAGIC, sizeof(FLAT_INDEX_MAGIC)) != 0
+        || header_->version != FLAT_INDEX_VERSION || header_->total_size != data.size()) {
+        throw std::invalid_argument("Data is not a flat index"s);
+    }
+
+    const FlatIndexHeader& header = *header_;
+    const uint64_t* stop_word_offsets = GetSection<uint64_t>(data, header.stop_word_offsets, header.stop_word_count + 1);
+    GetSection<char>(data, header.stop_word_chars, stop_word_offsets[header.stop_word_count]);
+    term_offsets_ = GetSection<uint64_t>(data, header.term_offsets, header.term_count + 1);
+    term_chars_ = GetSection<char>(data, header.term_chars, term_offsets_[header.term_count]);
+    term_hash_seeds_ = GetSection<uint32_t>(data, header.term_hash_seeds, header.term_hash_bucket_count);
+    term_hash_slots_ = GetSection<TermIndex>(data, header.term_hash_slots, header.term_count);
+    term_inverse_document_freqs_ = GetSection<double>(data, header.term_inverse_document_freqs, header.term_count);
+    posting_offsets_ = GetSection<uint64_t>(data, header.posting_offsets, header.term_count + 1);
+    posting_documents_ = GetSection<DocumentIndex>(data, header.posting_documents, header.posting_count);
+    posting_term_freqs_ = GetSection<double>(data, header.posting_term_freqs, header.posting_count);
+    document_ids_ = GetSection<int32_t>(data, header.document_ids, header.document_count);
+    document_ratings_ = GetSection<int32_t>(data, header.document_ratings, header.document_count);
+    document_statuses_ = GetSection<uint8_t>(data, header.document_statuses, header.document_count);
+    document_term_offsets_ = GetSection<uint64_t>(data, header.document_term_offsets, header.document_count + 1);
+    document_terms_ = GetSection<TermIndex>(data, header.document_terms, document_term_offsets_[header.document_count]);
+
+    // The data may come from a corrupt file, and queries index one section
+    // with values read from another without further checks.
+    if (!AreOffsetsValid(stop_word_offsets, header.stop_word_count) || !AreOffsetsValid(term_offsets_, header.term_count)) {
+        throw std::invalid_argument("Flat index words are inconsistent"s);
+    }
+    if (!AreOffsetsValid(posting_offsets_, header.term_count) || posting_offsets_[header.term_count] != header.posting_count
+        || std::any_of(posting_documents_, posting_documents_ + header.posting_count, [&header](DocumentIndex document) {
+            return document >= header.document_count;
+        })) {
+        throw std::invalid_argument("Flat index postings are inconsistent"s);
+    }
+    if (!AreOffsetsValid(document_term_offsets_, header.document_count)
+        || std::any_of(document_terms_, document_terms_ + document_term_offsets_[header.document_count], [&header](TermIndex term) {
+            return term >= header.term_count;
+        })) {
+        throw std::invalid_argument("Flat index forward index is inconsistent"s);
+    }
+
+    // Every seed maps into the slots, so the slots must hold each term once.
+    if ((header.term_count > 0) != (header.term_hash_bucket_count > 0) || header.term_hash_bucket_count > header.term_count) {
+        throw std::invalid_argument("Flat index term hash is inconsistent"s);
+    }
+    std::vector<bool> is_slotted(header.term_count);
+    for (const TermIndex* slot = term_hash_slots_; slot != term_hash_slots_ + header.term_count; ++slot) {
+        if (*slot >= header.term_count || is_slotted[*slot]) {
+            throw std::invalid_argument("Flat index term hash is inconsistent"s);
+        }
+        is_slotted[*slot] = true;
+    }
+}
+
+std::vector<Document> FlatIndex::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    });
+}
+
+std::vector<Document> FlatIndex::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::MatchResult FlatIndex::MatchDocument(std::string_view raw_query, int document_id) const {
+    using namespace std::string_literals;
+
+    const QueryTerms query = ParseQuery(raw_query);
+
+    const int32_t* ids_end = document_ids_ + header_->document_count;
+    const int32_t* id = std::lower_bound(document_ids_, ids_end, document_id);
+    if (id == ids_end || *id != document_id) {
+        throw std::out_of_range("Document "s + std::to_string(document_id) + " is not indexed"s);
+    }
+    const DocumentIndex document = id - document_ids_;
+    const DocumentStatus status = static_cast<DocumentStatus>(document_statuses_[document]);
+    const TermIndex* terms_begin = document_terms_ + document_term_offsets_[document];
+    const TermIndex* terms_end = document_terms_ + document_term_offsets_[document + 1];
+
+    const bool has_minus_word = std::any_of(query.minus_terms.begin(), query.minus_terms.end(),
+        [terms_begin, terms_end](TermIndex term) {
+            return std::binary_search(terms_begin, terms_end, term);
+        });
+    if (has_minus_word) {
+        return {std::vector<std::string_view>{}, status};
+    }
+
+    // Term indexes follow the lexicographic order, so the words come out sorted.
+    std::vector<std::string_view> matched_words;
+    auto lhs = query.plus_terms.begin();
+    const TermIndex* rhs = terms_begin;
+    while (lhs != query.plus_terms.end() && rhs != terms_end) {
+        if (*lhs < *rhs) {
+            ++lhs;
+        } else if (*rhs < *lhs) {
+            ++rhs;
+        } else {
+            matched_words.push_back(GetTerm(*lhs));
+            ++lhs;
+            ++rhs;
+        }
+    }
+
+    return {matched_words, status};
+}
+
+int FlatIndex::GetDocumentCount() const {
+    return static_cast<int>(header_->document_count);
+}
+
+uint64_t FlatIndex::GetGeneration() const {
+    return header_->generation;
+}
+
+MemoryStats FlatIndex::GetMemoryStats() const {
+    using namespace std::string_literals;
+
+    const FlatIndexHeader& header = *header_;
+    MemoryStats stats;
+    const auto add = [&stats](std::string name, size_t bytes, size_t elements) {
+        stats.structures.push_back({std::move(name), bytes, 1, elements});
+        stats.total_bytes += bytes;
+    };
+
+    const uint64_t term_char_count = term_offsets_[header.term_count];
+    add("term_dictionary"s, (header.term_count + 1) * sizeof(uint64_t) + term_char_count
+        + header.term_hash_bucket_count * sizeof(uint32_t) + header.term_count * sizeof(TermIndex), header.term_count);
+    add("inverse_document_freqs"s, header.term_count * sizeof(double), header.term_count);
+    add("postings"s, (header.term_count + 1) * sizeof(uint64_t)
+        + header.posting_count * (sizeof(DocumentIndex) + sizeof(double)), header.posting_count);
+    add("documents"s, header.document_count * (2 * sizeof(int32_t) + sizeof(uint8_t)), header.document_count);
+    add("forward_index"s, (header.document_count + 1) * sizeof(uint64_t)
+        + document_term_offsets_[header.document_count] * sizeof(TermIndex), document_term_offsets_[header.document_count]);
+    add("other"s, header.total_size - stats.total_bytes, 0);
+
+    return stats;
+}
+
+std::string_view FlatIndex::GetTerm(TermIndex term) const {
+    return {term_chars_ + term_offsets_[term], term_offsets_[term + 1] - term_offsets_[term]};
+}
+
+bool FlatIndex::FindTerm(std::string_view word, TermIndex& term) const {
+    if (header_->term_count == 0) {
+        return false;
+    }
+    term = FindPerfectHashCandidate(word, header_->term_hash_salt, term_hash_seeds_, header_->term_hash_bucket_count,
+                                    term_hash_slots_, header_->term_count);
+    return GetTerm(term) == word;
+}
+
+void FlatIndex::ExpandPrefix(std::string_view prefix, std::vector<TermIndex>& terms) const {
+    const auto find_first = [this, prefix](bool is_past_prefix) {
+        TermIndex begin = 0;
+        TermIndex end = static_cast<TermIndex>(header_->term_count);
+        while (begin < end) {
+            const TermIndex middle = begin + (end - begin) / 2;
+            const std::string_view term = GetTerm(middle);
+            const bool is_before = is_past_prefix ? term.substr(0, prefix.size()) <= prefix : term < prefix;
+            if (is_before) {
+                begin = middle + 1;
+            } else {
+                end = middle;
+            }
+        }
+        return begin;
+    };
+    const TermIndex first = find_first(false);
+    const TermIndex last = find_first(true);
+
+    std::vector<TermIndex> candidates;
+    for (TermIndex term = first; term < last; ++term) {
+        candidates.push_back(term);
+    }
+    if (candidates.size() > MAX_PREFIX_EXPANSION) {
+        const auto get_document_count = [this](TermIndex term) {
+            return posting_offsets_[term + 1] - posting_offsets_[term];
+        };
+        std::stable_sort(candidates.begin(), candidates.end(), [&get_document_count](TermIndex lhs, TermIndex rhs) {
+            return get_document_count(lhs) > get_document_count(rhs);
+        });
+        candidates.resize(MAX_PREFIX_EXPANSION);
+    }
+    terms.insert(terms.end(), candidates.begin(), candidates.end());
+}
+
+FlatIndex::QueryTerms FlatIndex::ParseQuery(std::string_view raw_query) const {
+    QueryTerms result;
+
+    for (std::string_view word : SplitIntoWords(raw_query)) {
+        const auto [data, is_minus, is_prefix] = ParseQueryWordText(word);
+        if (is_prefix) {
+            ExpandPrefix(data, is_minus ? result.minus_terms : result.plus_terms);
+            continue;
+        }
+        // Stop words never become terms, so they are dropped as unknown.
+        TermIndex term;
+        if (!FindTerm(data, term)) {
+            continue;
+        }
+        (is_minus ? result.minus_terms : result.plus_terms).push_back(term);
+    }
+
+    for (auto* terms : {&result.plus_terms, &result.minus_terms}) {
+        std::sort(terms->begin(), terms->end());
+        terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
+    }
+
+    return result;
+}
+
+const std::vector<std::pair<FlatIndex::DocumentIndex, double>>& FlatIndex::ComputeRelevance(const QueryTerms& query) const {
+    // Dense per-thread accumulator: only the touched slots are reset, so a
+    // query costs time proportional to its postings, not to the corpus.
+    thread_local RelevanceScratch scratch;
+    if (scratch.states.size() < header_->document_count) {
+        scratch.relevance.resize(header_->document_count);
+        scratch.states.resize(header_->document_count, RelevanceScratch::UNTOUCHED);
+    }
+    scratch.touched.clear();
+
+    for (TermIndex term : query.minus_terms) {
+        for (uint64_t i = posting_offsets_[term]; i < posting_offsets_[term + 1]; ++i) {
+            const DocumentIndex document = posting_documents_[i];
+            if (scratch.states[document] == RelevanceScratch::UNTOUCHED) {
+                scratch.touched.push_back(document);
+            }
+            scratch.states[document] = RelevanceScratch::EXCLUDED;
+        }
+    }
+
+    // Plus terms are sorted like the words of SearchServer::ParseQuery, so the
+    // sums are accumulated in the same order and come out bit-identical.
+    for (TermIndex term : query.plus_terms) {
+        const double inverse_document_freq = term_inverse_document_freqs_[term];
+        for (uint64_t i = posting_offsets_[term]; i < posting_offsets_[term + 1]; ++i) {
+            const DocumentIndex document = posting_documents_[i];
+            uint8_t& state = scratch.states[document];
+            if (state == RelevanceScratch::EXCLUDED) {
+                continue;
+            }
+            if (state == RelevanceScratch::UNTOUCHED) {
+                state = RelevanceScratch::MATCHED;
+                scratch.relevance[document] = 0.0;
+                scratch.touched.push_back(document);
+            }
+            scratch.relevance[document] += posting_term_freqs_[i] * inverse_document_freq;
+        }
+    }
+
+    std::sort(scratch.touched.begin(), scratch.touched.end());
+
+    scratch.matched.clear();
+    for (DocumentIndex document : scratch.touched) {
+        if (scratch.states[document] == RelevanceScratch::MATCHED) {
+            scratch.matched.emplace_back(document, scratch.relevance[document]);
+        }
+        scratch.states[document] = RelevanceScratch::UNTOUCHED;
+    }
+
+    return scratch.matched;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "memory_stats.h"
+#include "search_server.h"
+
+// Position-independent serialized index. Every section is a plain array, so
+// the bytes can be mapped from a file and queried in place by any number of
+// processes.
+struct FlatIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t generation;
+    uint64_t document_count;
+    uint64_t term_count;
+    uint64_t posting_count;
+    uint64_t stop_word_count;
+    // Byte offsets of the sections from the start of the index.
+    uint64_t stop_word_offsets;
+    uint64_t stop_word_chars;
+    uint64_t term_offsets;
+    uint64_t term_chars;
+    uint64_t term_hash_salt;
+    uint64_t term_hash_bucket_count;
+    uint64_t term_hash_seeds;
+    uint64_t term_hash_slots;
+    uint64_t term_inverse_document_freqs;
+    uint64_t posting_offsets;
+    uint64_t posting_documents;
+    uint64_t posting_term_freqs;
+    uint64_t document_ids;
+    uint64_t document_ratings;
+    uint64_t document_statuses;
+    uint64_t document_term_offsets;
+    uint64_t document_terms;
+    uint64_t total_size;
+};
+
+// Serializes the index of the server. Terms are sorted and found through a
+// minimal perfect hash, postings refer to documents by their position in the
+// sorted id column, and IDF is precomputed, so queries need no
+// allocation-heavy structures.
+std::string SerializeIndex(const SearchServer& search_server, uint64_t generation);
+
+// Read-only view over a serialized index. Does not own the bytes: the
+// matched words returned by MatchDocument point into them as well.
+class FlatIndex {
+public:
+    // Throws std::invalid_argument if the data is not a complete index.
+    explicit FlatIndex(std::string_view data);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    SearchServer::MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    uint64_t GetGeneration() const;
+
+    // Bytes of every section, grouped like SearchServer::GetMemoryStats.
+    MemoryStats GetMemoryStats() const;
+
+private:
+    using TermIndex = uint32_t;
+    using DocumentIndex = uint32_t;
+
+    struct QueryTerms {
+        std::vector<TermIndex> plus_terms;
+        std::vector<TermIndex> minus_terms;
+    };
+
+    const FlatIndexHeader* header_;
+    const uint64_t* term_offsets_;
+    const char* term_chars_;
+    const uint32_t* term_hash_seeds_;
+    const TermIndex* term_hash_slots_;
+    const double* term_inverse_document_freqs_;
+    const uint64_t* posting_offsets_;
+    const DocumentIndex* posting_documents_;
+    const double* posting_term_freqs_;
+    const int32_t* document_ids_;
+    const int32_t* document_ratings_;
+    const uint8_t* document_statuses_;
+    const uint64_t* document_term_offsets_;
+    const TermIndex* document_terms_;
+
+    std::string_view GetTerm(TermIndex term) const;
+    bool FindTerm(std::string_view word, TermIndex& term) const;
+    // Terms with the prefix, chosen like SearchServer::ExpandPrefix. They
+    // are a range of the sorted terms, found by binary search.
+    void ExpandPrefix(std::string_view prefix, std::vector<TermIndex>& terms) const;
+
+    // Sorted indexes of the known words; unknown and stop words are dropped.
+    QueryTerms ParseQuery(std::string_view raw_query) const;
+
+    // Relevance of every document that has a plus word and no minus word, in
+    // document order. The list is reused by the next call on the thread.
+    const std::vector<std::pair<DocumentIndex, double>>& ComputeRelevance(const QueryTerms& query) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> FlatIndex::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    // Matches go straight into a bounded heap, as in SearchServer, so a query
+    // neither stores nor sorts all of them.
+    TopDocuments top_documents(MAX_RESULT_DOCUMENT_COUNT);
+    for (const auto& [document, document_relevance] : ComputeRelevance(ParseQuery(raw_query))) {
+        const int document_id = document_ids_[document];
+        const int rating = document_ratings_[document];
+        if (document_predicate(document_id, static_cast<DocumentStatus>(document_statuses_[document]), rating)) {
+            top_documents.Push({document_id, document_relevance, rating});
+        }
+    }
+
+    return top_documents.Extract();
+}
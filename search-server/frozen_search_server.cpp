@@ -0,0 +1,43 @@
+#include "frozen_search_server.h"
+
+#include <utility>
+
+FrozenSearchServer::FrozenSearchServer(std::string data)
+    : data_(std::make_unique<const std::string>(std::move(data)))
+    , index_(*data_) {
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return index_.FindTopDocuments(raw_query, status);
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return index_.FindTopDocuments(raw_query);
+}
+
+SearchServer::MatchResult FrozenSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return index_.MatchDocument(raw_query, document_id);
+}
+
+int FrozenSearchServer::GetDocumentCount() const {
+    return index_.GetDocumentCount();
+}
+
+MemoryStats FrozenSearchServer::GetMemoryStats() const {
+    return index_.GetMemoryStats();
+}
+
+std::string_view FrozenSearchServer::GetIndexData() const {
+    return *data_;
+}
+
+FrozenSearchServer Freeze(SearchServer&& search_server) {
+    std::string data;
+    {
+        // The mutable structures are freed before the frozen server exists,
+        // so the peak footprint is one server plus one serialized index.
+        const SearchServer source(std::move(search_server));
+        data = SerializeIndex(source, 0);
+    }
+    return FrozenSearchServer(std::move(data));
+}
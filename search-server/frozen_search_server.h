@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "flat_index.h"
+#include "memory_stats.h"
+#include "search_server.h"
+
+// Read-only server for corpora that are built once and then only queried.
+// It keeps the flat index layout in memory instead of the node-based maps of
+// SearchServer: terms are found through a minimal perfect hash, postings are
+// contiguous and sorted by document ordinal, ratings and statuses are packed
+// columns and IDF is precomputed. There are no mutation methods; results are
+// identical to those of the server it was frozen from.
+class FrozenSearchServer {
+public:
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // The matched words stay valid for the lifetime of the frozen server.
+    SearchServer::MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    MemoryStats GetMemoryStats() const;
+
+    // The serialized flat index, e.g. to replicate it.
+    std::string_view GetIndexData() const;
+
+private:
+    friend FrozenSearchServer Freeze(SearchServer&& search_server);
+
+    explicit FrozenSearchServer(std::string data);
+
+    // Heap-allocated, so that moving the server does not move the bytes the
+    // index points into.
+    std::unique_ptr<const std::string> data_;
+    FlatIndex index_;
+};
+
+// Converts a fully built server and releases its mutable structures.
+FrozenSearchServer Freeze(SearchServer&& search_server);
+
+template <typename DocumentPredicate>
+std::vector<Document> FrozenSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return index_.FindTopDocuments(raw_query, document_predicate);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Draws indices 0..n-1 with P(k) ~ 1 / (k + 1)^exponent.
+// exponent == 0 gives the uniform distribution.
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t n, double exponent);
+
+    template <typename Generator>
+    size_t operator()(Generator& generator) const;
+
+    size_t size() const;
+
+private:
+    std::vector<double> cdf_;
+};
+
+template <typename Generator>
+size_t ZipfDistribution::operator()(Generator& generator) const {
+    const double point = std::uniform_real_distribution<>(0, cdf_.back())(generator);
+    const auto it = std::upper_bound(cdf_.begin(), cdf_.end(), point);
+    return std::min<size_t>(it - cdf_.begin(), cdf_.size() - 1);
+}
+
+std::string GenerateWord(std::mt19937& generator, int max_length);
+
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count, double minus_prob = 0);
+
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, const ZipfDistribution& word_distribution, int word_count, double minus_prob = 0);
+
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count, int max_word_count);
+
+// Words are drawn from a Zipf distribution over dictionary positions, so
+// the first dictionary words behave like the frequent words of real text.
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count, int max_word_count, double minus_prob, double zipf_exponent);
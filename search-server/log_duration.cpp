@@ -3,15 +3,15 @@
 
 #include "log_duration.h"
 
-LogDuration(const std::string& id)
+LogDuration::LogDuration(std::string_view id)
         : id_(id), stream_(std::cerr) {
     }
 
-LogDuration(const std::string& id, std::ostream& stream)
+LogDuration::LogDuration(std::string_view id, std::ostream& stream)
         : id_(id), stream_(stream) {
     }
 
-~LogDuration() {
+LogDuration::~LogDuration() {
         using namespace std::chrono;
         using namespace std::literals;
         using Clock = std::chrono::steady_clock;
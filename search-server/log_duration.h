@@ -2,6 +2,8 @@
 
 #include <chrono>
 #include <iostream>
+#include <string>
+#include <string_view>
 
 #define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
 #define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
@@ -13,9 +15,9 @@ class LogDuration {
 public:
     using Clock = std::chrono::steady_clock;
 
-    LogDuration(const std::string& id);
+    LogDuration(std::string_view id);
 
-    LogDuration(const std::string& id, std::ostream& stream);
+    LogDuration(std::string_view id, std::ostream& stream);
 
     ~LogDuration();
 
@@ -0,0 +1,182 @@
+#include "mapped_index.h"
+
+#include "file_io.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const int MAX_ATTACH_ATTEMPTS = 8;
+
+std::string GetCurrentPath(const std::string& directory) {
+    using namespace std::string_literals;
+    return directory + "/CURRENT"s;
+}
+
+std::string GetIndexPath(const std::string& directory, uint64_t generation) {
+    using namespace std::string_literals;
+    return directory + "/index-"s + std::to_string(generation);
+}
+
+class FileMapping {
+public:
+    FileMapping(void* address, size_t size)
+        : address_(address)
+        , size_(size) {
+    }
+
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+
+    ~FileMapping() {
+        munmap(address_, size_);
+    }
+
+    std::string_view GetData() const {
+        return {static_cast<const char*>(address_), size_};
+    }
+
+private:
+    void* address_;
+    size_t size_;
+};
+
+struct MappedFlatIndex {
+    std::unique_ptr<FileMapping> mapping;
+    FlatIndex index;
+};
+
+// Null if the file is gone: the builder may have replaced it between
+// reading CURRENT and opening it.
+std::shared_ptr<const FlatIndex> MapIndexFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return nullptr;
+        }
+        throw MakeSystemError("Cannot open", path);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw MakeSystemError("Cannot stat", path);
+    }
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    void* address = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw MakeSystemError("Cannot map", path);
+    }
+
+    auto mapping = std::make_unique<FileMapping>(address, size);
+    const std::string_view data = mapping->GetData();
+    auto holder = std::make_shared<MappedFlatIndex>(MappedFlatIndex{std::move(mapping), FlatIndex(data)});
+    return std::shared_ptr<const FlatIndex>(holder, &holder->index);
+}
+
+std::shared_ptr<const FlatIndex> MapCurrentIndex(const std::string& directory) {
+    using namespace std::string_literals;
+
+    for (int attempt = 0; attempt < MAX_ATTACH_ATTEMPTS; ++attempt) {
+        const uint64_t generation = ReadCurrentGeneration(directory);
+        if (generation == 0) {
+            throw std::runtime_error("No index is published in "s + directory);
+        }
+        if (auto index = MapIndexFile(GetIndexPath(directory, generation))) {
+            return index;
+        }
+    }
+    throw std::runtime_error("Index in "s + directory + " keeps changing"s);
+}
+
+} // namespace
+
+uint64_t ReadCurrentGeneration(const std::string& directory) {
+    const std::string path = GetCurrentPath(directory);
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        throw MakeSystemError("Cannot open", path);
+    }
+    char buffer[32] = {};
+    const ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (size < 0) {
+        throw MakeSystemError("Cannot read", path);
+    }
+    return std::strtoull(buffer, nullptr, 10);
+}
+
+uint64_t PublishIndex(const SearchServer& search_server, const std::string& directory) {
+    using namespace std::string_literals;
+
+    const uint64_t generation = ReadCurrentGeneration(directory) + 1;
+    const std::string index_path = GetIndexPath(directory, generation);
+    WriteFile(index_path + ".tmp"s, SerializeIndex(search_server, generation));
+    RenameFile(index_path + ".tmp"s, index_path);
+
+    const std::string current_path = GetCurrentPath(directory);
+    WriteFile(current_path + ".tmp"s, std::to_string(generation) + "\n"s);
+    RenameFile(current_path + ".tmp"s, current_path);
+    SyncDirectory(directory);
+
+    // The previous generation stays for readers that have just read the old
+    // CURRENT. Mapped files outlive their unlinking, so older readers are safe.
+    if (generation > 2) {
+        unlink(GetIndexPath(directory, generation - 2).c_str());
+    }
+
+    return generation;
+}
+
+MappedIndex::MappedIndex(std::string directory)
+    : directory_(std::move(directory))
+    , index_(MapCurrentIndex(directory_)) {
+}
+
+bool MappedIndex::Refresh() {
+    if (ReadCurrentGeneration(directory_) == GetGeneration()) {
+        return false;
+    }
+
+    auto index = MapCurrentIndex(directory_);
+    std::lock_guard guard(mutex_);
+    if (index->GetGeneration() <= index_->GetGeneration()) {
+        return false;
+    }
+    index_ = std::move(index);
+    return true;
+}
+
+std::shared_ptr<const FlatIndex> MappedIndex::GetSnapshot() const {
+    std::lock_guard guard(mutex_);
+    return index_;
+}
+
+uint64_t MappedIndex::GetGeneration() const {
+    return GetSnapshot()->GetGeneration();
+}
+
+std::vector<Document> MappedIndex::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return GetSnapshot()->FindTopDocuments(raw_query, status);
+}
+
+std::vector<Document> MappedIndex::FindTopDocuments(std::string_view raw_query) const {
+    return GetSnapshot()->FindTopDocuments(raw_query);
+}
+
+SearchServer::MatchResult MappedIndex::MatchDocument(std::string_view raw_query, int document_id) const {
+    return GetSnapshot()->MatchDocument(raw_query, document_id);
+}
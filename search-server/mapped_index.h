@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "flat_index.h"
+#include "search_server.h"
+
+// Writes the index as the next generation into the directory and makes it
+// current with an atomic rename. Readers that still map an older generation
+// keep serving it until they refresh. Meant for a single builder process.
+// Returns the published generation.
+uint64_t PublishIndex(const SearchServer& search_server, const std::string& directory);
+
+// Generation named by the CURRENT file of the directory, 0 if none.
+uint64_t ReadCurrentGeneration(const std::string& directory);
+
+// Read-only view of the index published into a directory. The file is
+// mapped, not copied, so every serving process shares the same page cache.
+class MappedIndex {
+public:
+    // Throws std::runtime_error if nothing is published yet.
+    explicit MappedIndex(std::string directory);
+
+    // Maps the current generation if it is newer than the attached one.
+    bool Refresh();
+
+    // Holding the snapshot keeps its mapping alive, so words returned by
+    // MatchDocument stay valid while other threads refresh.
+    std::shared_ptr<const FlatIndex> GetSnapshot() const;
+
+    uint64_t GetGeneration() const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // The matched words point into the current mapping and stay valid until
+    // Refresh attaches a newer one; hold a snapshot to keep them longer.
+    SearchServer::MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+private:
+    std::string directory_;
+    mutable std::mutex mutex_;
+    std::shared_ptr<const FlatIndex> index_;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> MappedIndex::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return GetSnapshot()->FindTopDocuments(raw_query, document_predicate);
+}
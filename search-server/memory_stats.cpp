@@ -0,0 +1,19 @@
+#include "memory_stats.h"
+
+#include <iomanip>
+
+std::ostream& operator<<(std::ostream& out, const MemoryStats& stats) {
+    using namespace std::string_literals;
+    for (const StructureMemory& structure : stats.structures) {
+        out << std::left << std::setw(24) << structure.name << std::right
+            << std::setw(14) << structure.bytes << " bytes"s
+            << std::setw(12) << structure.blocks << " blocks"s
+            << std::setw(12) << structure.elements << " elements"s << std::endl;
+    }
+    out << std::left << std::setw(24) << "total"s << std::right << std::setw(14) << stats.total_bytes << " bytes"s << std::endl;
+    out << "empty postings: "s << stats.empty_postings
+        << ", removed postings: "s << stats.removed_postings
+        << ", orphaned word frequencies: "s << stats.orphaned_word_frequencies
+        << ", peak query scratch: "s << stats.peak_query_scratch_bytes << " bytes"s << std::endl;
+    return out;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct StructureMemory {
+    std::string name;
+    // Heap bytes and blocks requested through the structure's allocator.
+    size_t bytes = 0;
+    size_t blocks = 0;
+    // What counts as an element is structure-specific: terms, postings,
+    // documents, ids...
+    size_t elements = 0;
+};
+
+struct MemoryStats {
+    std::vector<StructureMemory> structures;
+    size_t total_bytes = 0;
+    // Terms whose posting list became empty after RemoveDocument.
+    size_t empty_postings = 0;
+    // Postings of removed documents that Compact has not dropped yet.
+    size_t removed_postings = 0;
+    // Word frequency maps left behind by removed documents.
+    size_t orphaned_word_frequencies = 0;
+    // Most heap memory the queries have held at once for scoring, since the
+    // server was built. Not part of total_bytes.
+    size_t peak_query_scratch_bytes = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryStats& stats);
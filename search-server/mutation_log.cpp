@@ -0,0 +1,264 @@
+#include "mutation_log.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "file_io.h"
+
+namespace {
+
+// Payload size and payload checksum.
+const size_t FRAME_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+struct Frame {
+    size_t offset;
+    size_t size;
+};
+
+// False for a record that does not decode, whatever its checksum says.
+bool DecodeMutation(std::string_view payload, Mutation& mutation) {
+    uint8_t type = 0;
+    int32_t document_id = 0;
+    if (!ReadValue(payload, mutation.sequence) || !ReadValue(payload, type) || !ReadValue(payload, document_id)) {
+        return false;
+    }
+    mutation.type = static_cast<MutationType>(type);
+    mutation.document_id = document_id;
+    if (mutation.type == MutationType::REMOVE_DOCUMENT) {
+        return payload.empty();
+    }
+    if (mutation.type != MutationType::ADD_DOCUMENT) {
+        return false;
+    }
+
+    uint8_t status = 0;
+    uint32_t rating_count = 0;
+    if (!ReadValue(payload, status) || !ReadValue(payload, rating_count) || payload.size() / sizeof(int32_t) < rating_count) {
+        return false;
+    }
+    mutation.status = static_cast<DocumentStatus>(status);
+    mutation.ratings.resize(rating_count);
+    for (int& rating : mutation.ratings) {
+        int32_t value = 0;
+        ReadValue(payload, value);
+        rating = value;
+    }
+    uint32_t text_size = 0;
+    if (!ReadValue(payload, text_size) || payload.size() != text_size) {
+        return false;
+    }
+    mutation.text = payload;
+    return true;
+}
+
+} // namespace
+
+MutationLog::MutationLog(std::string path)
+    : path_(std::move(path))
+    , fd_(open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644)) {
+    if (fd_ < 0) {
+        throw MakeSystemError("Cannot open", path_);
+    }
+}
+
+MutationLog::~MutationLog() {
+    close(fd_);
+}
+
+size_t MutationLog::Replay(uint64_t after_sequence, const std::function<void(const Mutation&)>& apply) {
+    using namespace std::string_literals;
+
+    const std::string data = ReadFile(path_).value_or(std::string());
+
+    std::vector<Frame> frames;
+    std::vector<uint32_t> checksums;
+    for (std::string_view rest = data; rest.size() >= FRAME_HEADER_SIZE;) {
+        uint32_t size = 0;
+        uint32_t checksum = 0;
+        ReadValue(rest, size);
+        ReadValue(rest, checksum);
+        if (rest.size() < size) {
+            break;
+        }
+        frames.push_back({data.size() - rest.size(), size});
+        checksums.push_back(checksum);
+        rest.remove_prefix(size);
+    }
+
+    std::vector<Mutation> mutations(frames.size());
+    std::vector<char> is_intact(frames.size());
+    std::vector<size_t> indexes(frames.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        const std::string_view payload = std::string_view(data).substr(frames[i].offset, frames[i].size);
+        is_intact[i] = ComputeCrc32(payload) == checksums[i] && DecodeMutation(payload, mutations[i]);
+    });
+
+    size_t intact_count = 0;
+    uint64_t sequence = after_sequence;
+    while (intact_count < frames.size() && is_intact[intact_count] && mutations[intact_count].sequence > (intact_count > 0 ? mutations[intact_count - 1].sequence : 0)) {
+        sequence = std::max(sequence, mutations[intact_count].sequence);
+        ++intact_count;
+    }
+    // A crash tears only the end of the log. Damage followed by an intact
+    // record, or a record out of sequence, is corruption, and cutting there
+    // would drop records that were synced.
+    if (intact_count < frames.size()
+        && (is_intact[intact_count] || std::any_of(is_intact.begin() + intact_count + 1, is_intact.end(), [](char is_frame_intact) {
+               return is_frame_intact;
+           }))) {
+        throw std::invalid_argument("Mutation log "s + path_ + " is corrupt"s);
+    }
+    const size_t intact_size = intact_count > 0 ? frames[intact_count - 1].offset + frames[intact_count - 1].size : 0;
+    if (intact_size < data.size()) {
+        if (ftruncate(fd_, static_cast<off_t>(intact_size)) != 0 || fdatasync(fd_) != 0) {
+            throw MakeSystemError("Cannot truncate", path_);
+        }
+    }
+
+    // An addition removed again later in the log need not be indexed at all.
+    std::vector<char> is_skipped(intact_count);
+    std::unordered_map<int, size_t> pending_additions;
+    for (size_t i = 0; i < intact_count; ++i) {
+        const Mutation& mutation = mutations[i];
+        if (mutation.sequence <= after_sequence) {
+            is_skipped[i] = true;
+        } else if (mutation.type == MutationType::ADD_DOCUMENT) {
+            pending_additions[mutation.document_id] = i;
+        } else if (const auto it = pending_additions.find(mutation.document_id); it != pending_additions.end()) {
+            is_skipped[it->second] = is_skipped[i] = true;
+            pending_additions.erase(it);
+        }
+    }
+
+    size_t applied_count = 0;
+    for (size_t i = 0; i < intact_count; ++i) {
+        if (!is_skipped[i]) {
+            apply(mutations[i]);
+            ++applied_count;
+        }
+    }
+
+    std::lock_guard guard(mutex_);
+    last_sequence_ = synced_sequence_ = sequence;
+    return applied_count;
+}
+
+size_t MutationLog::BeginRecord(MutationType type, int document_id) {
+    CheckNotFailed();
+    const size_t begin = pending_.size();
+    pending_.append(FRAME_HEADER_SIZE, '\0');
+    AppendValue(pending_, last_sequence_ + 1);
+    AppendValue(pending_, static_cast<uint8_t>(type));
+    AppendValue(pending_, static_cast<int32_t>(document_id));
+    return begin;
+}
+
+uint64_t MutationLog::EndRecord(size_t begin) {
+    const std::string_view payload = std::string_view(pending_).substr(begin + FRAME_HEADER_SIZE);
+    const uint32_t size = static_cast<uint32_t>(payload.size());
+    const uint32_t checksum = ComputeCrc32(payload);
+    std::memcpy(&pending_[begin], &size, sizeof(size));
+    std::memcpy(&pending_[begin + sizeof(size)], &checksum, sizeof(checksum));
+    return ++last_sequence_;
+}
+
+uint64_t MutationLog::AppendAddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    std::lock_guard guard(mutex_);
+    const size_t begin = BeginRecord(MutationType::ADD_DOCUMENT, document_id);
+    AppendValue(pending_, static_cast<uint8_t>(status));
+    AppendValue(pending_, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        AppendValue(pending_, static_cast<int32_t>(rating));
+    }
+    AppendValue(pending_, static_cast<uint32_t>(document.size()));
+    pending_.append(document);
+    return EndRecord(begin);
+}
+
+uint64_t MutationLog::AppendRemoveDocument(int document_id) {
+    std::lock_guard guard(mutex_);
+    return EndRecord(BeginRecord(MutationType::REMOVE_DOCUMENT, document_id));
+}
+
+void MutationLog::Sync(uint64_t sequence) {
+    std::unique_lock lock(mutex_);
+    while (synced_sequence_ < sequence) {
+        CheckNotFailed();
+        if (is_writing_) {
+            // The running write may not cover this record; check again after it.
+            synced_.wait(lock);
+            continue;
+        }
+
+        // Become the leader: write everything buffered so far, including the
+        // records of the threads that are waiting.
+        is_writing_ = true;
+        writing_.swap(pending_);
+        const uint64_t target_sequence = last_sequence_;
+        lock.unlock();
+        bool is_written = true;
+        try {
+            WriteAll(fd_, writing_, path_);
+            if (fdatasync(fd_) != 0) {
+                throw MakeSystemError("Cannot sync", path_);
+            }
+        } catch (...) {
+            is_written = false;
+        }
+        lock.lock();
+
+        writing_.clear();
+        is_writing_ = false;
+        if (is_written) {
+            synced_sequence_ = std::max(synced_sequence_, target_sequence);
+            ++sync_count_;
+        } else {
+            is_failed_ = true;
+        }
+        synced_.notify_all();
+    }
+}
+
+void MutationLog::Truncate(uint64_t sequence) {
+    using namespace std::string_literals;
+
+    std::unique_lock lock(mutex_);
+    synced_.wait(lock, [this] {
+        return !is_writing_;
+    });
+    if (sequence != last_sequence_) {
+        throw std::invalid_argument("Truncation must cover every appended record"s);
+    }
+    if (ftruncate(fd_, 0) != 0 || fdatasync(fd_) != 0) {
+        throw MakeSystemError("Cannot truncate", path_);
+    }
+    // The snapshot holds whatever was still buffered.
+    pending_.clear();
+    synced_sequence_ = sequence;
+    is_failed_ = false;
+    synced_.notify_all();
+}
+
+uint64_t MutationLog::GetLastSequence() const {
+    std::lock_guard guard(mutex_);
+    return last_sequence_;
+}
+
+uint64_t MutationLog::GetSyncCount() const {
+    std::lock_guard guard(mutex_);
+    return sync_count_;
+}
+
+void MutationLog::CheckNotFailed() const {
+    using namespace std::string_literals;
+    if (is_failed_) {
+        throw std::runtime_error("Mutation log "s + path_ + " failed to write"s);
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+enum class MutationType : uint8_t {
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENT = 2,
+};
+
+struct Mutation {
+    uint64_t sequence = 0;
+    MutationType type = MutationType::ADD_DOCUMENT;
+    int document_id = 0;
+    // The rest is set for ADD_DOCUMENT only.
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string_view text;
+};
+
+// Append-only write-ahead log of server mutations. Every record carries a
+// sequence number and a CRC-32, so a record torn by a crash is detected and
+// dropped on replay, and a record damaged later is reported. Appends only buffer the record; Sync makes it durable,
+// and threads that sync at the same time share one write and one fdatasync
+// (group commit).
+class MutationLog {
+public:
+    // Opens the log, creating an empty one if the file does not exist.
+    explicit MutationLog(std::string path);
+    ~MutationLog();
+
+    MutationLog(const MutationLog&) = delete;
+    MutationLog& operator=(const MutationLog&) = delete;
+
+    // Calls apply for every intact record with a sequence above
+    // after_sequence, in log order. A torn tail, damaged records with no
+    // intact record after them, is cut off, so that appends continue after
+    // intact data. Damage in the middle of the log throws
+    // std::invalid_argument and leaves the file as it is. Records are verified and decoded in parallel, and an
+    // addition that a later removal cancels is skipped together with it.
+    // Must precede the first append. Returns the number of applied records.
+    size_t Replay(uint64_t after_sequence, const std::function<void(const Mutation&)>& apply);
+
+    // Buffer the record and return its sequence number.
+    uint64_t AppendAddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    uint64_t AppendRemoveDocument(int document_id);
+
+    // Blocks until every record up to sequence is on disk.
+    void Sync(uint64_t sequence);
+
+    // Empties the log once a snapshot holds every record up to sequence,
+    // which must be the last one appended.
+    void Truncate(uint64_t sequence);
+
+    uint64_t GetLastSequence() const;
+    // Number of fdatasync calls so far.
+    uint64_t GetSyncCount() const;
+
+private:
+    std::string path_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable synced_;
+    // Encoded records that are not written yet.
+    std::string pending_;
+    // Buffer of the write in progress, kept to reuse its capacity.
+    std::string writing_;
+    uint64_t last_sequence_ = 0;
+    uint64_t synced_sequence_ = 0;
+    uint64_t sync_count_ = 0;
+    bool is_writing_ = false;
+    // Set by a failed write: the file may end with a partial record, so
+    // nothing more is appended after it.
+    bool is_failed_ = false;
+
+    // Reserves the frame header, returning its offset.
+    size_t BeginRecord(MutationType type, int document_id);
+    uint64_t EndRecord(size_t begin);
+    void CheckNotFailed() const;
+};
@@ -0,0 +1,230 @@
+#include "numa_search_server.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifdef SEARCH_SERVER_HAS_LIBNUMA
+#include <numa.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+struct NumaNode {
+    int id = 0;
+    int cpu_count = 0;
+};
+
+// Nodes that have CPUs, or none if libnuma is missing or unusable.
+std::vector<NumaNode> GetNumaNodes() {
+    std::vector<NumaNode> nodes;
+#ifdef SEARCH_SERVER_HAS_LIBNUMA
+    if (numa_available() < 0) {
+        return nodes;
+    }
+    bitmask* cpus = numa_allocate_cpumask();
+    for (int node = 0; node <= numa_max_node(); ++node) {
+        if (numa_bitmask_isbitset(numa_all_nodes_ptr, node) && numa_node_to_cpus(node, cpus) == 0) {
+            const int cpu_count = static_cast<int>(numa_bitmask_weight(cpus));
+            if (cpu_count > 0) {
+                nodes.push_back({node, cpu_count});
+            }
+        }
+    }
+    numa_free_cpumask(cpus);
+#endif
+    return nodes;
+}
+
+std::shared_ptr<const char> CopyToNode(std::string_view data, int node) {
+#ifdef SEARCH_SERVER_HAS_LIBNUMA
+    // Page-aligned, so the copy satisfies the alignment of FlatIndex.
+    void* memory = numa_alloc_onnode(data.size(), node);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    std::memcpy(memory, data.data(), data.size());
+    const size_t size = data.size();
+    return std::shared_ptr<const char>(static_cast<const char*>(memory), [size](const char* memory) {
+        numa_free(const_cast<char*>(memory), size);
+    });
+#else
+    throw std::bad_alloc();
+#endif
+}
+
+} // namespace
+
+NumaSearchServer::NumaSearchServer(const FrozenSearchServer& search_server, const NumaOptions& options) {
+    const std::string_view data = search_server.GetIndexData();
+    const std::vector<NumaNode> nodes = options.enabled ? GetNumaNodes() : std::vector<NumaNode>{};
+
+    if (nodes.size() > 1) {
+        for (const NumaNode& node : nodes) {
+            auto replica = std::make_unique<Replica>();
+            replica->node = node.id;
+            replica->data = CopyToNode(data, node.id);
+            replica->worker_count = options.threads_per_node > 0 ? options.threads_per_node : node.cpu_count;
+            replicas_.push_back(std::move(replica));
+        }
+    } else {
+        // A single replica that does not own the bytes.
+        auto replica = std::make_unique<Replica>();
+        replica->data = std::shared_ptr<const char>(std::shared_ptr<const char>(), data.data());
+        replica->worker_count = options.threads_per_node > 0 ? options.threads_per_node
+                                                             : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        replicas_.push_back(std::move(replica));
+    }
+    for (auto& replica : replicas_) {
+        replica->index.emplace(std::string_view(replica->data.get(), data.size()));
+    }
+
+    try {
+        for (size_t replica_index = 0; replica_index < replicas_.size(); ++replica_index) {
+            for (int i = 0; i < replicas_[replica_index]->worker_count; ++i) {
+                workers_.emplace_back([this, replica_index] {
+                    RunWorker(replica_index);
+                });
+            }
+        }
+    } catch (...) {
+        Stop();
+        throw;
+    }
+}
+
+NumaSearchServer::~NumaSearchServer() {
+    Stop();
+}
+
+std::vector<Document> NumaSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return GetLocalReplica().index->FindTopDocuments(raw_query);
+}
+
+SearchServer::MatchResult NumaSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return GetLocalReplica().index->MatchDocument(raw_query, document_id);
+}
+
+std::vector<std::vector<Document>> NumaSearchServer::ProcessQueries(const std::vector<std::string>& queries) const {
+    std::vector<std::vector<Document>> results(queries.size());
+    if (queries.empty()) {
+        return results;
+    }
+
+    std::lock_guard batch_lock(batch_mutex_);
+    Batch batch;
+    batch.queries = &queries;
+    batch.results = &results;
+
+    // Shares follow the cumulative worker count, so they add up exactly.
+    size_t workers_before = 0;
+    for (auto& replica : replicas_) {
+        replica->next_query.store(queries.size() * workers_before / workers_.size(), std::memory_order_relaxed);
+        workers_before += replica->worker_count;
+        replica->end_query = queries.size() * workers_before / workers_.size();
+    }
+
+    {
+        std::unique_lock lock(mutex_);
+        batch_ = &batch;
+        busy_workers_ = static_cast<int>(workers_.size());
+        ++batch_generation_;
+        batch_ready_.notify_all();
+        batch_done_.wait(lock, [this] {
+            return busy_workers_ == 0;
+        });
+        batch_ = nullptr;
+    }
+
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+    return results;
+}
+
+int NumaSearchServer::GetReplicaCount() const {
+    return static_cast<int>(replicas_.size());
+}
+
+int NumaSearchServer::GetWorkerCount() const {
+    return static_cast<int>(workers_.size());
+}
+
+const NumaSearchServer::Replica& NumaSearchServer::GetLocalReplica() const {
+#ifdef SEARCH_SERVER_HAS_LIBNUMA
+    if (replicas_.size() > 1) {
+        const int cpu = sched_getcpu();
+        const int node = cpu >= 0 ? numa_node_of_cpu(cpu) : -1;
+        for (const auto& replica : replicas_) {
+            if (replica->node == node) {
+                return *replica;
+            }
+        }
+    }
+#endif
+    return *replicas_.front();
+}
+
+void NumaSearchServer::RunWorker(size_t replica_index) {
+    const Replica& replica = *replicas_[replica_index];
+#ifdef SEARCH_SERVER_HAS_LIBNUMA
+    if (replica.node >= 0) {
+        numa_run_on_node(replica.node);
+    }
+#endif
+
+    uint64_t seen_generation = 0;
+    while (true) {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock lock(mutex_);
+            batch_ready_.wait(lock, [this, seen_generation] {
+                return is_stopping_ || batch_generation_ != seen_generation;
+            });
+            if (is_stopping_) {
+                return;
+            }
+            seen_generation = batch_generation_;
+            batch = batch_;
+        }
+
+        try {
+            // The own share first, then the leftovers of the other nodes.
+            for (size_t i = 0; i < replicas_.size(); ++i) {
+                const Replica& share = *replicas_[(replica_index + i) % replicas_.size()];
+                for (size_t query = share.next_query.fetch_add(1, std::memory_order_relaxed); query < share.end_query;
+                     query = share.next_query.fetch_add(1, std::memory_order_relaxed)) {
+                    (*batch->results)[query] = replica.index->FindTopDocuments((*batch->queries)[query]);
+                }
+            }
+        } catch (...) {
+            {
+                std::lock_guard lock(batch->error_mutex);
+                if (!batch->error) {
+                    batch->error = std::current_exception();
+                }
+            }
+            for (const auto& share : replicas_) {
+                share->next_query.store(share->end_query, std::memory_order_relaxed);
+            }
+        }
+
+        std::lock_guard lock(mutex_);
+        if (--busy_workers_ == 0) {
+            batch_done_.notify_all();
+        }
+    }
+}
+
+void NumaSearchServer::Stop() {
+    {
+        std::lock_guard lock(mutex_);
+        is_stopping_ = true;
+    }
+    batch_ready_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "flat_index.h"
+#include "frozen_search_server.h"
+#include "search_server.h"
+
+struct NumaOptions {
+    // Replicate and pin when libnuma reports more than one node. Otherwise
+    // there is a single replica and the workers are not pinned.
+    bool enabled = true;
+    // Workers per replica, 0 for one per CPU of its node.
+    int threads_per_node = 0;
+};
+
+// Serves a frozen index from one replica per NUMA node. Every replica is a
+// copy of the index bytes allocated on its node, and every worker thread is
+// pinned to the CPUs of one node and only reads that node's replica, so no
+// query touches remote memory. Without NUMA the frozen server's own bytes are
+// shared, which must then outlive this object.
+class NumaSearchServer {
+public:
+    explicit NumaSearchServer(const FrozenSearchServer& search_server, const NumaOptions& options = {});
+    ~NumaSearchServer();
+
+    NumaSearchServer(const NumaSearchServer&) = delete;
+    NumaSearchServer& operator=(const NumaSearchServer&) = delete;
+
+    // Answered on the calling thread from the replica of its current node.
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    SearchServer::MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    // Same results as ProcessQueries. The batch is split between the nodes in
+    // proportion to their workers; a worker that runs out of local queries
+    // takes over the rest of another node's share, still answering from its
+    // own replica. Rethrows the first exception of a query.
+    std::vector<std::vector<Document>> ProcessQueries(const std::vector<std::string>& queries) const;
+
+    int GetReplicaCount() const;
+    int GetWorkerCount() const;
+
+private:
+    struct Replica {
+        // -1 when NUMA is not used.
+        int node = -1;
+        std::shared_ptr<const char> data;
+        std::optional<FlatIndex> index;
+        int worker_count = 0;
+        // Share of the current batch: [next_query, end_query).
+        mutable std::atomic<size_t> next_query{0};
+        mutable size_t end_query = 0;
+    };
+
+    struct Batch {
+        const std::vector<std::string>* queries = nullptr;
+        std::vector<std::vector<Document>>* results = nullptr;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+
+    std::vector<std::unique_ptr<Replica>> replicas_;
+    std::vector<std::thread> workers_;
+
+    // ProcessQueries runs one batch at a time.
+    mutable std::mutex batch_mutex_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable batch_ready_;
+    mutable std::condition_variable batch_done_;
+    mutable Batch* batch_ = nullptr;
+    mutable uint64_t batch_generation_ = 0;
+    mutable int busy_workers_ = 0;
+    bool is_stopping_ = false;
+
+    const Replica& GetLocalReplica() const;
+    void RunWorker(size_t replica_index);
+    void Stop();
+};
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <algorithm>
-#include <iostream>
 #include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <vector>
 
 template <typename Iterator>
 class IteratorRange {
@@ -73,3 +76,85 @@ template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
 }
+
+// Paginator that stores no pages: each page range is computed when the
+// iterator reaches it, so memory does not grow with the number of pages.
+template <typename Iterator>
+class LazyPaginator {
+public:
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        PageIterator(Iterator begin, size_t left, size_t page_size)
+            : begin_(begin)
+            , left_(left)
+            , page_size_(page_size) {
+        }
+
+        IteratorRange<Iterator> operator*() const {
+            return {begin_, std::next(begin_, std::min(page_size_, left_))};
+        }
+
+        PageIterator& operator++() {
+            const size_t current_page_size = std::min(page_size_, left_);
+            begin_ = std::next(begin_, current_page_size);
+            left_ -= current_page_size;
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return left_ == other.left_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Iterator begin_;
+        size_t left_;
+        size_t page_size_;
+    };
+
+    LazyPaginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , end_(end)
+        , item_count_(std::distance(begin, end))
+        , page_size_(page_size) {
+        assert(page_size > 0);
+    }
+
+    PageIterator begin() const {
+        return {begin_, item_count_, page_size_};
+    }
+
+    PageIterator end() const {
+        return {end_, 0, page_size_};
+    }
+
+    size_t size() const {
+        return (item_count_ + page_size_ - 1) / page_size_;
+    }
+
+private:
+    Iterator begin_;
+    Iterator end_;
+    size_t item_count_;
+    size_t page_size_;
+};
+
+template <typename Container>
+auto PaginateLazily(const Container& c, size_t page_size) {
+    return LazyPaginator(begin(c), end(c), page_size);
+}
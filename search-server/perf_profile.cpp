@@ -0,0 +1,280 @@
+#include "perf_profile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <utility>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#define SEARCH_SERVER_HAS_PERF_EVENT
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<PerfScopeSite*> sites;
+    bool is_enabled = false;
+    // Empty for every scope.
+    std::set<std::string, std::less<>> scopes;
+
+    bool IsProfiled(const char* name) const {
+        return is_enabled && (scopes.empty() || scopes.count(std::string_view(name)) > 0);
+    }
+};
+
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+std::atomic<bool> has_any_counters{false};
+
+uint64_t NowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The counters of one thread, read as a group so that they cover the same
+// instructions.
+class ThreadCounters {
+public:
+    ThreadCounters() {
+#ifdef SEARCH_SERVER_HAS_PERF_EVENT
+        // Cycles lead the group; a counter the CPU lacks stays at zero.
+        const std::pair<uint32_t, uint64_t> events[PERF_COUNTER_COUNT] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            // Last level cache misses on x86.
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (size_t counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[counter].first;
+            attr.config = events[counter].second;
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd_, 0));
+            if (fd < 0) {
+                if (counter == 0) {
+                    return;
+                }
+                continue;
+            }
+            if (counter == 0) {
+                group_fd_ = fd;
+            }
+            fds_.push_back(fd);
+            group_positions_[counter] = static_cast<int>(fds_.size());
+        }
+        has_any_counters.store(true, std::memory_order_relaxed);
+#endif
+    }
+
+    ~ThreadCounters() {
+#ifdef SEARCH_SERVER_HAS_PERF_EVENT
+        for (int fd : fds_) {
+            close(fd);
+        }
+#endif
+    }
+
+    ThreadCounters(const ThreadCounters&) = delete;
+    ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+    bool IsOpen() const {
+        return group_fd_ >= 0;
+    }
+
+    // Leaves the values at zero if the counters are unavailable.
+    void Read(uint64_t (&values)[PERF_COUNTER_COUNT]) const {
+#ifdef SEARCH_SERVER_HAS_PERF_EVENT
+        if (group_fd_ < 0) {
+            return;
+        }
+        // The number of counters, then their values in the order of opening.
+        uint64_t group[1 + PERF_COUNTER_COUNT] = {};
+        if (read(group_fd_, group, sizeof(uint64_t) * (1 + fds_.size())) <= 0) {
+            return;
+        }
+        for (size_t counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+            if (group_positions_[counter] > 0) {
+                values[counter] = group[group_positions_[counter]];
+            }
+        }
+#else
+        (void)values;
+#endif
+    }
+
+private:
+    int group_fd_ = -1;
+    std::vector<int> fds_;
+    // 1-based position of every counter in a group read, 0 if not open.
+    int group_positions_[PERF_COUNTER_COUNT] = {};
+};
+
+// Opened on the first profiled scope of the thread.
+const ThreadCounters& GetThreadCounters() {
+    thread_local const ThreadCounters counters;
+    return counters;
+}
+
+thread_local PerfScope* innermost_scope = nullptr;
+
+double Ratio(uint64_t numerator, uint64_t denominator) {
+    return denominator == 0 ? 0.0 : static_cast<double>(numerator) / denominator;
+}
+
+} // namespace
+
+double ScopeCounters::GetInstructionsPerCycle() const {
+    return Ratio(instructions, cycles);
+}
+
+double ScopeCounters::GetLlcMissesPerPosting() const {
+    return Ratio(llc_misses, postings);
+}
+
+double ScopeCounters::GetBranchMissesPerPosting() const {
+    return Ratio(branch_misses, postings);
+}
+
+std::ostream& operator<<(std::ostream& out, const PerfProfile& profile) {
+    using namespace std::string_literals;
+    if (!profile.has_counters) {
+        out << "hardware counters unavailable, only calls, time and postings are measured"s << std::endl;
+    }
+    out << std::left << std::setw(20) << "scope"s << std::right
+        << std::setw(10) << "calls"s
+        << std::setw(12) << "ms"s
+        << std::setw(12) << "postings"s
+        << std::setw(14) << "cycles"s
+        << std::setw(14) << "instructions"s
+        << std::setw(7) << "ipc"s
+        << std::setw(14) << "llc/posting"s
+        << std::setw(14) << "br/posting"s << std::endl;
+    out << std::fixed;
+    for (const ScopeCounters& scope : profile.scopes) {
+        out << std::left << std::setw(20) << scope.name << std::right
+            << std::setw(10) << scope.calls
+            << std::setw(12) << std::setprecision(3) << scope.nanoseconds / 1e6
+            << std::setw(12) << scope.postings
+            << std::setw(14) << scope.cycles
+            << std::setw(14) << scope.instructions
+            << std::setw(7) << std::setprecision(2) << scope.GetInstructionsPerCycle()
+            << std::setw(14) << std::setprecision(4) << scope.GetLlcMissesPerPosting()
+            << std::setw(14) << std::setprecision(4) << scope.GetBranchMissesPerPosting() << std::endl;
+    }
+    out << std::defaultfloat;
+    return out;
+}
+
+void EnablePerfProfiling(const std::vector<std::string>& scopes) {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.is_enabled = true;
+    registry.scopes.clear();
+    registry.scopes.insert(scopes.begin(), scopes.end());
+    for (PerfScopeSite* site : registry.sites) {
+        site->is_profiled_.store(registry.IsProfiled(site->name_), std::memory_order_relaxed);
+    }
+}
+
+void DisablePerfProfiling() {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.is_enabled = false;
+    for (PerfScopeSite* site : registry.sites) {
+        site->is_profiled_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void ResetPerfProfile() {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    for (PerfScopeSite* site : registry.sites) {
+        site->calls_.store(0, std::memory_order_relaxed);
+        site->nanoseconds_.store(0, std::memory_order_relaxed);
+        site->postings_.store(0, std::memory_order_relaxed);
+        for (auto& counter : site->counters_) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+PerfProfile GetPerfProfile() {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    std::map<std::string, ScopeCounters> scopes;
+    for (const PerfScopeSite* site : registry.sites) {
+        const uint64_t calls = site->calls_.load(std::memory_order_relaxed);
+        if (calls == 0) {
+            continue;
+        }
+        ScopeCounters& scope = scopes[site->name_];
+        scope.name = site->name_;
+        scope.calls += calls;
+        scope.nanoseconds += site->nanoseconds_.load(std::memory_order_relaxed);
+        scope.postings += site->postings_.load(std::memory_order_relaxed);
+        scope.cycles += site->counters_[static_cast<size_t>(PerfCounter::CYCLES)].load(std::memory_order_relaxed);
+        scope.instructions += site->counters_[static_cast<size_t>(PerfCounter::INSTRUCTIONS)].load(std::memory_order_relaxed);
+        scope.llc_misses += site->counters_[static_cast<size_t>(PerfCounter::LLC_MISSES)].load(std::memory_order_relaxed);
+        scope.branch_misses += site->counters_[static_cast<size_t>(PerfCounter::BRANCH_MISSES)].load(std::memory_order_relaxed);
+    }
+
+    PerfProfile profile;
+    profile.has_counters = has_any_counters.load(std::memory_order_relaxed);
+    for (auto& [_, scope] : scopes) {
+        profile.scopes.push_back(std::move(scope));
+    }
+    return profile;
+}
+
+bool HasPerfCounters() {
+    return GetThreadCounters().IsOpen();
+}
+
+PerfScopeSite::PerfScopeSite(const char* name)
+    : name_(name) {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.sites.push_back(this);
+    is_profiled_.store(registry.IsProfiled(name_), std::memory_order_relaxed);
+}
+
+void PerfScope::AddPostings(uint64_t count) {
+    if (innermost_scope) {
+        innermost_scope->postings_ += count;
+    }
+}
+
+void PerfScope::Start(PerfScopeSite& site) {
+    site_ = &site;
+    outer_ = std::exchange(innermost_scope, this);
+    start_nanoseconds_ = NowNanoseconds();
+    GetThreadCounters().Read(start_counters_);
+}
+
+void PerfScope::Stop() {
+    uint64_t stop_counters[PERF_COUNTER_COUNT] = {};
+    GetThreadCounters().Read(stop_counters);
+    const uint64_t stop_nanoseconds = NowNanoseconds();
+    innermost_scope = outer_;
+
+    site_->calls_.fetch_add(1, std::memory_order_relaxed);
+    site_->nanoseconds_.fetch_add(stop_nanoseconds - start_nanoseconds_, std::memory_order_relaxed);
+    site_->postings_.fetch_add(postings_, std::memory_order_relaxed);
+    for (size_t counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        site_->counters_[counter].fetch_add(stop_counters[counter] - start_counters_[counter], std::memory_order_relaxed);
+    }
+}
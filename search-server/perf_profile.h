@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "log_duration.h"
+
+// Hardware counters around the hot scopes of a query, for finding out why a
+// scope is slow rather than only that it is. Profiling is off by default;
+// while it is off a scope costs one relaxed load. While it is on every scope
+// reads the counters of its thread on entry and exit (two system calls), so
+// profile with queries, not with single postings.
+//
+// The counters are opened per thread with perf_event_open and count user
+// space only. Where they are unavailable (not Linux, perf_event_paranoid,
+// seccomp, a VM without a PMU) the scopes still record calls, time and
+// postings, and HasPerfCounters() is false.
+//
+// A scope counts the thread it runs on and nothing else, so work handed to
+// other threads needs scopes of its own inside the tasks. The parallel
+// FindAllDocuments is measured that way: "score_par" covers the calling
+// thread and reports no postings, and "score_par_word" is opened in every
+// per-word task and reports the postings that task scans. Per-posting ratios
+// are meaningful for "score" and "score_par_word", not for "score_par".
+#define PERF_SCOPE_SITE PROFILE_CONCAT(perfSite, __LINE__)
+#define PERF_SCOPE(name)                           \
+    static PerfScopeSite PERF_SCOPE_SITE(name);    \
+    PerfScope PROFILE_CONCAT(perfScope, __LINE__)(PERF_SCOPE_SITE)
+
+struct ScopeCounters {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t nanoseconds = 0;
+    // Reported by the scope through PerfScope::AddPostings.
+    uint64_t postings = 0;
+    // Zero without hardware counters.
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t llc_misses = 0;
+    uint64_t branch_misses = 0;
+
+    double GetInstructionsPerCycle() const;
+    double GetLlcMissesPerPosting() const;
+    double GetBranchMissesPerPosting() const;
+};
+
+// Sums over all threads and all sites of a scope name, ordered by name.
+struct PerfProfile {
+    std::vector<ScopeCounters> scopes;
+    bool has_counters = false;
+};
+
+std::ostream& operator<<(std::ostream& out, const PerfProfile& profile);
+
+// Profiles the named scopes, or every scope if none is given.
+void EnablePerfProfiling(const std::vector<std::string>& scopes = {});
+void DisablePerfProfiling();
+void ResetPerfProfile();
+PerfProfile GetPerfProfile();
+
+// Whether the calling thread could open the hardware counters.
+bool HasPerfCounters();
+
+enum class PerfCounter {
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    COUNT,
+};
+
+constexpr size_t PERF_COUNTER_COUNT = static_cast<size_t>(PerfCounter::COUNT);
+
+// A place in the code that PERF_SCOPE measures; static, so the sums of a
+// site are found without a lookup.
+class PerfScopeSite {
+public:
+    explicit PerfScopeSite(const char* name);
+
+    PerfScopeSite(const PerfScopeSite&) = delete;
+    PerfScopeSite& operator=(const PerfScopeSite&) = delete;
+
+    bool IsProfiled() const {
+        return is_profiled_.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class PerfScope;
+    friend void EnablePerfProfiling(const std::vector<std::string>& scopes);
+    friend void DisablePerfProfiling();
+    friend void ResetPerfProfile();
+    friend PerfProfile GetPerfProfile();
+
+    const char* name_;
+    std::atomic<bool> is_profiled_{false};
+    std::atomic<uint64_t> calls_{0};
+    std::atomic<uint64_t> nanoseconds_{0};
+    std::atomic<uint64_t> postings_{0};
+    std::atomic<uint64_t> counters_[PERF_COUNTER_COUNT] = {};
+};
+
+class PerfScope {
+public:
+    explicit PerfScope(PerfScopeSite& site) {
+        if (site.IsProfiled()) {
+            Start(site);
+        }
+    }
+
+    ~PerfScope() {
+        if (site_) {
+            Stop();
+        }
+    }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+    // Adds to the innermost profiled scope of the calling thread, if any.
+    static void AddPostings(uint64_t count);
+
+private:
+    PerfScopeSite* site_ = nullptr;
+    PerfScope* outer_ = nullptr;
+    uint64_t postings_ = 0;
+    uint64_t start_nanoseconds_ = 0;
+    uint64_t start_counters_[PERF_COUNTER_COUNT] = {};
+
+    void Start(PerfScopeSite& site);
+    void Stop();
+};
@@ -0,0 +1,127 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Keys per bucket on average. Larger buckets make the table smaller but
+// their seeds harder to find.
+const size_t KEYS_PER_BUCKET = 4;
+const int MAX_SALT_ATTEMPTS = 16;
+
+uint64_t Mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Places the keys with the given salt, or returns false if some bucket
+// found no seed.
+bool TryBuild(const std::vector<std::string_view>& keys, uint64_t salt, PerfectHash& result) {
+    const size_t key_count = keys.size();
+    const size_t bucket_count = (key_count + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+
+    std::vector<uint64_t> hashes(key_count);
+    std::vector<std::vector<uint32_t>> buckets(bucket_count);
+    for (size_t i = 0; i < key_count; ++i) {
+        hashes[i] = HashPerfectHashKey(keys[i], salt);
+        buckets[hashes[i] % bucket_count].push_back(static_cast<uint32_t>(i));
+    }
+
+    // Large buckets go first, while most slots are still free.
+    std::vector<uint32_t> order(bucket_count);
+    for (size_t i = 0; i < bucket_count; ++i) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t lhs, uint32_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    result.salt = salt;
+    result.seeds.assign(bucket_count, 0);
+    result.slots.assign(key_count, 0);
+    std::vector<bool> is_taken(key_count, false);
+    std::vector<size_t> bucket_slots;
+    // The last single-key buckets look for one of a few free slots, which
+    // takes about key_count attempts.
+    const uint64_t max_seed = std::min<uint64_t>(64 * key_count + 1024, UINT32_MAX);
+
+    for (uint32_t bucket : order) {
+        const auto& bucket_keys = buckets[bucket];
+        if (bucket_keys.empty()) {
+            break;
+        }
+        bool is_placed = false;
+        for (uint64_t seed = 0; seed < max_seed && !is_placed; ++seed) {
+            bucket_slots.clear();
+            is_placed = true;
+            for (uint32_t key : bucket_keys) {
+                const size_t slot = GetPerfectHashSlot(hashes[key], static_cast<uint32_t>(seed), key_count);
+                if (is_taken[slot] || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+                    is_placed = false;
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+            if (is_placed) {
+                result.seeds[bucket] = static_cast<uint32_t>(seed);
+                for (size_t i = 0; i < bucket_keys.size(); ++i) {
+                    is_taken[bucket_slots[i]] = true;
+                    result.slots[bucket_slots[i]] = bucket_keys[i];
+                }
+            }
+        }
+        if (!is_placed) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+PerfectHash BuildPerfectHash(const std::vector<std::string_view>& keys) {
+    using namespace std::string_literals;
+
+    PerfectHash result;
+    if (keys.empty()) {
+        return result;
+    }
+    if (keys.size() > UINT32_MAX) {
+        throw std::invalid_argument("Too many keys for a perfect hash"s);
+    }
+    std::vector<std::string_view> sorted_keys = keys;
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    if (std::adjacent_find(sorted_keys.begin(), sorted_keys.end()) != sorted_keys.end()) {
+        throw std::invalid_argument("Perfect hash keys are not distinct"s);
+    }
+
+    // Distinct keys with equal 64-bit hashes cannot be separated by any
+    // seed, so a failed salt is followed by another one.
+    for (int attempt = 0; attempt < MAX_SALT_ATTEMPTS; ++attempt) {
+        if (TryBuild(keys, Mix(attempt + 1), result)) {
+            return result;
+        }
+    }
+
+    throw std::invalid_argument("Cannot build a perfect hash of the keys"s);
+}
+
+uint64_t HashPerfectHashKey(std::string_view key, uint64_t salt) {
+    uint64_t hash = salt ^ (key.size() * 0x9E3779B97F4A7C15ull);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= key.size(); i += sizeof(uint64_t)) {
+        uint64_t chunk;
+        std::memcpy(&chunk, key.data() + i, sizeof(chunk));
+        hash = Mix(hash ^ chunk);
+    }
+    if (i < key.size()) {
+        uint64_t chunk = 0;
+        std::memcpy(&chunk, key.data() + i, key.size() - i);
+        hash = Mix(hash ^ chunk);
+    }
+    return Mix(hash);
+}
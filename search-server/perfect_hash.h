@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Minimal perfect hash over a fixed set of distinct keys (hash and displace):
+// keys are grouped into buckets by one hash, and every bucket stores the
+// seed of a second hash that sends its keys to free slots. The n keys land
+// in exactly n slots, so a lookup costs two hashes and one comparison with
+// the candidate key, whose index the caller keeps in the slot.
+struct PerfectHash {
+    uint64_t salt = 0;
+    // Seed of the displacement hash for each bucket.
+    std::vector<uint32_t> seeds;
+    // Key index stored in each slot.
+    std::vector<uint32_t> slots;
+};
+
+// Throws std::invalid_argument if the keys are not distinct.
+PerfectHash BuildPerfectHash(const std::vector<std::string_view>& keys);
+
+uint64_t HashPerfectHashKey(std::string_view key, uint64_t salt);
+
+inline size_t GetPerfectHashSlot(uint64_t hash, uint32_t seed, size_t slot_count) {
+    uint64_t z = hash ^ (seed * 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (z ^ (z >> 31)) % slot_count;
+}
+
+// Index of the only key that may be equal to the given one.
+inline uint32_t FindPerfectHashCandidate(std::string_view key, uint64_t salt, const uint32_t* seeds, size_t bucket_count,
+                                         const uint32_t* slots, size_t slot_count) {
+    const uint64_t hash = HashPerfectHashKey(key, salt);
+    return slots[GetPerfectHashSlot(hash, seeds[hash % bucket_count], slot_count)];
+}
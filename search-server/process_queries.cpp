@@ -17,6 +17,10 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
     return documents_lists;
 }
 
+std::vector<std::vector<Document>> ProcessQueriesBatched(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    return search_server.FindTopDocumentsBatch(queries);
+}
+
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
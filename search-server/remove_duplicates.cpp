@@ -1,4 +1,5 @@
 #include "remove_duplicates.h"
+#include "perf_profile.h"
 
 #include <map>
 #include <string>
@@ -20,6 +21,7 @@ bool MyCompare (const std::map<std::string, double>& lhs, const std::map<std::st
 
 void RemoveDuplicates(SearchServer& search_server) {
     using namespace std::string_literals;
+    PERF_SCOPE("remove_duplicates");
 
     std::map<int, std::map<std::string, double>> temp;
 
@@ -28,19 +30,17 @@ void RemoveDuplicates(SearchServer& search_server) {
     std::vector<int> ids;
 
     for (int id : search_server) {
-        const auto content = search_server.GetWordFrequencies(id);
+        const auto& content = search_server.GetWordFrequencies(id);
         for (auto& cont : content) {
-            temp[id][cont.first] = cont.second;
-            ids.push_back(id);
+            temp[id][std::string(cont.first)] = cont.second;
         }
+        ids.push_back(id);
     }
 
-    int i = 0;
-    for (int id = ids[i]; i < ids.size(); id = ids[++i]) {
-        int j = i;
-        for (int id_ = ids[j]; j < ids.size(); id_ = ids[++j]) {
-            if (id != id_ && MyCompare(temp[id], temp[id_]) ) {
-                marks.insert(id_);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        for (size_t j = i + 1; j < ids.size(); ++j) {
+            if (MyCompare(temp[ids[i]], temp[ids[j]])) {
+                marks.insert(ids[j]);
             }
         }
     }
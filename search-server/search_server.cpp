@@ -4,9 +4,27 @@
 #include <algorithm>
 #include <numeric>
 #include <iostream>
+#include <iterator>
 #include <set>
 #include <execution>
 
+std::vector<std::string_view> SelectPrefixExpansion(std::vector<std::pair<std::string_view, int>> candidates) {
+    if (candidates.size() > MAX_PREFIX_EXPANSION) {
+        // Words come sorted, so a stable order by frequency keeps ties lexicographic.
+        std::stable_sort(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second > rhs.second;
+        });
+        candidates.resize(MAX_PREFIX_EXPANSION);
+    }
+
+    std::vector<std::string_view> words;
+    words.reserve(candidates.size());
+    for (const auto& [word, document_count] : candidates) {
+        words.push_back(word);
+    }
+    return words;
+}
+
 SearchServer::SearchServer(const std::string& stop_words_text)
     : SearchServer(SplitIntoWords(stop_words_text)){
 }
@@ -18,34 +36,191 @@ SearchServer::SearchServer(std::string_view stop_words_text)
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
     using namespace std::string_literals;
 
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || HasDocument(document_id)) {
         throw std::invalid_argument("Invalid document_id"s);
     }
+    // Checked up front, so that a rejected document leaves no trace.
+    CheckDocument(document, status);
+    // Stale postings of an earlier document with this id would mix in.
+    if (removed_documents_.Contains(document_id)) {
+        Compact();
+    }
 
-    const auto [it, inserted] = documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, std::string(document)});
+    MemoryCounters& counters = *memory_counters_;
+    const auto [it, inserted] = documents_.emplace(document_id, DocumentData{
+        ComputeAverageRating(ratings),
+        status,
+        String(document, Allocator<char>(&counters.document_texts)),
+        TermIds(Allocator<TermId>(&counters.forward_index))});
     
     const auto words = SplitIntoWordsNoStop(it->second.document_words);
 
     const double inv_word_count = 1.0 / words.size();
 
+    TermIds& term_ids = it->second.term_ids;
+    term_ids.reserve(words.size());
+
     for (std::string_view word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+        const TermId term_id = AddTerm(word);
+        word = terms_[term_id];
+        term_ids.push_back(term_id);
+        PostingList& posting_list = word_to_document_freqs_.try_emplace(word, PostingList{
+            Postings(Allocator<Postings::value_type>(&counters.word_to_document_freqs))}).first->second;
+        const auto [posting, is_new_document] = posting_list.postings.try_emplace(document_id, 0.0);
+        posting->second += inv_word_count;
+        posting_list.document_count += is_new_document;
+        if (term_postings_.size() <= term_id) {
+            term_postings_.resize(term_id + 1, nullptr);
+        }
+        term_postings_[term_id] = &posting_list;
+        document_to_word_freqs_.try_emplace(document_id, Allocator<WordFrequencies::value_type>(&counters.document_to_word_freqs))
+            .first->second[word] += inv_word_count;
     }
 
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    term_ids.shrink_to_fit();
+
     document_ids_.insert(document_id);
+    status_documents_[static_cast<size_t>(status)].Add(document_id);
+    ++epoch_;
+}
+
+void SearchServer::CheckDocument(std::string_view document, DocumentStatus status) const {
+    using namespace std::string_literals;
+
+    if (!FindStatusDocuments(status)) {
+        throw std::invalid_argument("Invalid document status"s);
+    }
+    // Spaces are valid characters, so one scan of the text covers every
+    // word; the split then throws naming the invalid one.
+    if (!IsValidWord(document)) {
+        SplitIntoWordsNoStop(document);
+    }
+}
+
+bool SearchServer::HasDocument(int document_id) const {
+    return documents_.count(document_id) > 0;
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+    return FindTopDocuments(raw_query, WithStatus{status});
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, statistics, WithStatus{status});
+}
+
+std::vector<Document> SearchServer::FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size, DocumentStatus status) const {
+    return FindTopDocumentsPage(raw_query, page, page_size, WithStatus{status});
+}
+
+std::vector<Document> SearchServer::FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size) const {
+    return FindTopDocumentsPage(raw_query, page, page_size, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> SearchServer::FindTopDocumentsAfter(std::string_view raw_query, const Document& last, size_t page_size, DocumentStatus status) const {
+    return FindTopDocumentsAfter(raw_query, last, page_size, WithStatus{status});
+}
+
+std::vector<Document> SearchServer::FindTopDocumentsAfter(std::string_view raw_query, const Document& last, size_t page_size) const {
+    return FindTopDocumentsAfter(raw_query, last, page_size, DocumentStatus::ACTUAL);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, DocumentStatus status) const {
+    return FindTopDocumentsBatch(raw_queries, WithStatus{status});
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const {
+    return FindTopDocumentsBatch(raw_queries, DocumentStatus::ACTUAL);
+}
+
+BudgetedDocuments SearchServer::FindTopDocumentsWithin(std::string_view raw_query, const QueryBudget& budget, DocumentStatus status) const {
+    return FindTopDocumentsWithin(raw_query, budget, WithStatus{status});
+}
+
+BudgetedDocuments SearchServer::FindTopDocumentsWithin(std::string_view raw_query, const QueryBudget& budget) const {
+    return FindTopDocumentsWithin(raw_query, budget, DocumentStatus::ACTUAL);
+}
+
+size_t SearchServer::EstimateQueryCost(std::string_view raw_query) const {
+    const auto query = ParseQuery(raw_query);
+
+    size_t cost = 0;
+    for (const auto* words : {&query.plus_words, &query.minus_words}) {
+        for (std::string_view word : *words) {
+            const auto it = word_to_document_freqs_.find(word);
+            if (it != word_to_document_freqs_.end()) {
+                cost += it->second.postings.size();
+            }
+        }
+    }
+
+    return cost;
+}
+
+CorpusStatistics SearchServer::GetCorpusStatistics(std::string_view raw_query) const {
+    return GetCorpusStatistics(raw_query, {});
+}
+
+CorpusStatistics SearchServer::GetCorpusStatistics(std::string_view raw_query, const PrefixExpansions& prefix_expansions) const {
+    const auto query = ParseQuery(raw_query, &prefix_expansions);
+
+    CorpusStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+
+    for (std::string_view word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end() && it->second.document_count > 0) {
+            statistics.document_freqs.emplace(word, it->second.document_count);
+        }
+    }
+
+    return statistics;
+}
+
+SearchServer::PreparedQuery SearchServer::PrepareQuery(std::string_view raw_query) const {
+    const auto query = ParseQuery(raw_query);
+
+    PreparedQuery result;
+    result.search_server_ = this;
+    result.epoch_ = epoch_;
+
+    // Kept in the lexicographic order of the words: it is the order in which
+    // the k-way merge adds up relevance, so the sums are bit-identical to
+    // those of FindTopDocuments. The merge does not gain from visiting the
+    // rarest terms first.
+    result.plus_terms_ = FindScoredTerms(query, nullptr);
+    result.excluded_ = CollectDocuments(query.minus_words);
+
+    return result;
+}
+
+bool SearchServer::IsPreparedQueryCurrent(const PreparedQuery& query) const {
+    return query.search_server_ == this && query.epoch_ == epoch_;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const {
+    return FindTopDocuments(query, WithStatus{status});
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const {
+    return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+std::vector<std::string_view> SearchServer::PreparedQuery::GetPlusWords() const {
+    std::vector<std::string_view> words;
+    words.reserve(plus_terms_.size());
+    for (const ScoredTerm& term : plus_terms_) {
+        words.push_back(term.word);
+    }
+    return words;
+}
+
 int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
@@ -55,10 +230,7 @@ bool SearchServer::IsStopWord(std::string_view word) const {
 }
 
 bool SearchServer::IsValidWord(std::string_view word) {
-    // A valid word must not contain special characters
-    return std::none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-    });
+    return ::IsValidWord(word);
 }
 
 std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
@@ -93,43 +265,122 @@ struct SearchServer::QueryWord {
     std::string_view data;
     bool is_minus;
     bool is_stop;
+    bool is_prefix;
 };
 
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word) const {
-    using namespace std::string_literals;
+    const auto [data, is_minus, is_prefix] = ParseQueryWordText(word);
+    return {data, is_minus, !is_prefix && IsStopWord(data), is_prefix};
+}
+
+std::vector<std::pair<std::string_view, int>> SearchServer::GetPrefixCandidates(std::string_view prefix) const {
+    std::vector<std::pair<std::string_view, int>> candidates;
+    for (auto it = term_ids_.lower_bound(prefix); it != term_ids_.end(); ++it) {
+        const std::string_view word = terms_[it->second];
+        if (word.substr(0, prefix.size()) != prefix) {
+            break;
+        }
+        const PostingList* posting_list = term_postings_[it->second];
+        if (posting_list && posting_list->document_count > 0) {
+            candidates.emplace_back(word, posting_list->document_count);
+        }
+    }
+    return candidates;
+}
 
-    if (word.empty()) {
-        throw std::invalid_argument("Query word is empty"s);
+std::vector<std::string_view> SearchServer::ExpandPrefix(std::string_view prefix) const {
+    return SelectPrefixExpansion(GetPrefixCandidates(prefix));
+}
+
+std::vector<std::string_view> SearchServer::ExpandPrefix(std::string_view prefix, const PrefixExpansions* prefix_expansions) const {
+    if (prefix_expansions) {
+        const auto it = prefix_expansions->find(prefix);
+        if (it != prefix_expansions->end()) {
+            return {it->second.begin(), it->second.end()};
+        }
     }
+    return ExpandPrefix(prefix);
+}
 
-    bool is_minus = false;
+double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
+    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).document_count);
+}
 
-    if (word[0] == '-') {
-        is_minus = true;
-        word = word.substr(1);
+double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word, const CorpusStatistics& statistics) const {
+    const auto it = statistics.document_freqs.find(word);
+    if (it == statistics.document_freqs.end()) {
+        return ComputeWordInverseDocumentFreq(word);
     }
+    return log(statistics.document_count * 1.0 / it->second);
+}
+
+std::vector<SearchServer::ScoredTerm> SearchServer::FindScoredTerms(const Query& query, const CorpusStatistics* statistics) const {
+    std::vector<ScoredTerm> result;
+    result.reserve(query.plus_words.size());
 
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw std::invalid_argument("Query word "s + std::string(word) + " is invalid"s);
+    for (std::string_view word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end() || it->second.document_count == 0) {
+            continue;
+        }
+        const double inverse_document_freq = statistics ? ComputeWordInverseDocumentFreq(word, *statistics)
+                                                        : ComputeWordInverseDocumentFreq(word);
+        result.push_back({it->first, &it->second.postings, inverse_document_freq});
     }
 
-    return {word, is_minus, IsStopWord(word)};
+    return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+DocumentBitmap SearchServer::CollectDocuments(const std::vector<std::string_view>& words) const {
+    DocumentBitmap result;
+
+    for (std::string_view word : words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end()) {
+            continue;
+        }
+        for (const auto [document_id, _] : it->second.postings) {
+            result.Add(document_id);
+        }
+    }
+
+    return result;
+}
+
+const DocumentBitmap* SearchServer::FindStatusDocuments(DocumentStatus status) const {
+    const size_t index = static_cast<size_t>(status);
+    return index < status_documents_.size() ? &status_documents_[index] : nullptr;
+}
+
+std::vector<Document> SearchServer::SelectTopDocuments(std::vector<Document> matched_documents) {
+    PERF_SCOPE("sort");
+    sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+
+    return matched_documents;
+}
+
+void SearchServer::CheckPreparedQuery(const PreparedQuery& query) const {
+    using namespace std::string_literals;
+
+    if (!IsPreparedQueryCurrent(query)) {
+        throw std::invalid_argument("Prepared query is stale"s);
+    }
 }
 
-std::set<int>::iterator SearchServer::begin() {
+SearchServer::DocumentIds::iterator SearchServer::begin() {
     return(document_ids_.begin());
 }
 
-std::set<int>::iterator SearchServer::end() {
+SearchServer::DocumentIds::iterator SearchServer::end() {
     return(document_ids_.end());
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const std::map<std::string_view, double> dummy;
+const SearchServer::WordFrequencies& SearchServer::GetWordFrequencies(int document_id) const {
+    static const WordFrequencies dummy(Allocator<WordFrequencies::value_type>(nullptr));
 
     bool check_for_existing_id = binary_search(document_ids_.begin(), document_ids_.end(), document_id);
 
@@ -140,74 +391,218 @@ const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int d
     return (dummy);
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
+MemoryStats SearchServer::GetMemoryStats() const {
+    using namespace std::string_literals;
+
+    MemoryStats stats;
+    const auto add = [&stats](std::string name, const AllocationCounter& counter, size_t elements) {
+        stats.structures.push_back({std::move(name), counter.bytes.load(), counter.blocks.load(), elements});
+        stats.total_bytes += counter.bytes.load();
+    };
+
+    size_t postings_count = 0;
+    for (const auto& [word, posting_list] : word_to_document_freqs_) {
+        postings_count += posting_list.postings.size();
+        stats.removed_postings += posting_list.postings.size() - posting_list.document_count;
+        if (posting_list.postings.empty()) {
+            ++stats.empty_postings;
+        }
+    }
+
+    size_t word_frequencies_count = 0;
+    for (const auto& [document_id, word_freqs] : document_to_word_freqs_) {
+        word_frequencies_count += word_freqs.size();
+        if (documents_.count(document_id) == 0) {
+            ++stats.orphaned_word_frequencies;
+        }
+    }
+
+    size_t forward_index_count = 0;
+    size_t text_length = 0;
+    for (const auto& [document_id, document_data] : documents_) {
+        forward_index_count += document_data.term_ids.size();
+        text_length += document_data.document_words.size();
+    }
+
+    const MemoryCounters& counters = *memory_counters_;
+    add("term_dictionary"s, counters.term_dictionary, terms_.size());
+    add("word_to_document_freqs"s, counters.word_to_document_freqs, postings_count);
+    add("document_to_word_freqs"s, counters.document_to_word_freqs, word_frequencies_count);
+    add("documents"s, counters.documents, documents_.size());
+    add("document_texts"s, counters.document_texts, text_length);
+    add("forward_index"s, counters.forward_index, forward_index_count);
+    add("document_ids"s, counters.document_ids, document_ids_.size());
+    size_t status_bitmap_count = 0;
+    for (const DocumentBitmap& documents : status_documents_) {
+        status_bitmap_count += documents.GetCount();
+    }
+    add("status_bitmaps"s, counters.status_bitmaps, status_bitmap_count);
+    add("removed_documents"s, counters.removed_documents, removed_documents_.GetCount());
+    stats.peak_query_scratch_bytes = counters.query_scratch.peak_bytes.load();
+
+    return stats;
+}
+
+SearchServer::TermId SearchServer::AddTerm(std::string_view word) {
+    auto it = term_ids_.find(word);
+    if (it == term_ids_.end()) {
+        it = term_ids_.emplace(String(word, Allocator<char>(&memory_counters_->term_dictionary)), static_cast<TermId>(terms_.size())).first;
+        terms_.push_back(it->first);
+    }
+    return it->second;
+}
+
+std::vector<SearchServer::TermId> SearchServer::FindTermIds(const std::vector<std::string_view>& words) const {
+    std::vector<TermId> result;
+    result.reserve(words.size());
+
+    for (std::string_view word : words) {
+        const auto it = term_ids_.find(word);
+        if (it != term_ids_.end()) {
+            result.push_back(it->second);
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+SearchServer::QueryTerms SearchServer::FindQueryTerms(const Query& query) const {
+    return {FindTermIds(query.plus_words), FindTermIds(query.minus_words)};
+}
+
+SearchServer::MatchResult SearchServer::MatchTerms(const QueryTerms& query_terms, const DocumentData& document_data) const {
+    const TermIds& document_terms = document_data.term_ids;
+
+    // Both sides are sorted, so each check is a single linear merge.
+    const auto has_common_term = [&document_terms](const std::vector<TermId>& terms) {
+        auto lhs = terms.begin();
+        auto rhs = document_terms.begin();
+        while (lhs != terms.end() && rhs != document_terms.end()) {
+            if (*lhs < *rhs) {
+                ++lhs;
+            } else if (*rhs < *lhs) {
+                ++rhs;
+            } else {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (has_common_term(query_terms.minus_terms)) {
+        return {std::vector<std::string_view>{}, document_data.status};
+    }
+
+    std::vector<TermId> matched_terms;
+    std::set_intersection(query_terms.plus_terms.begin(), query_terms.plus_terms.end(),
+                          document_terms.begin(), document_terms.end(),
+                          std::back_inserter(matched_terms));
+
+    std::vector<std::string_view> matched_words;
+    matched_words.reserve(matched_terms.size());
+    for (TermId term_id : matched_terms) {
+        matched_words.push_back(terms_[term_id]);
+    }
+    std::sort(matched_words.begin(), matched_words.end());
+
+    return {matched_words, document_data.status};
+}
+
+SearchServer::MatchResult SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
     return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
-    using namespace std::string_literals;
+SearchServer::MatchResult SearchServer::MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const {
+    const auto query_terms = FindQueryTerms(ParseQuery(raw_query));
+
+    return MatchTerms(query_terms, documents_.at(document_id));
+}
+
+SearchServer::MatchResult SearchServer::MatchDocument(std::string_view raw_query, const PrefixExpansions& prefix_expansions, int document_id) const {
+    const auto query_terms = FindQueryTerms(ParseQuery(raw_query, &prefix_expansions));
+
+    return MatchTerms(query_terms, documents_.at(document_id));
+}
 
+SearchServer::MatchResult SearchServer::MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
     const auto query = ParseQueryExecPol(raw_query);
+    const DocumentData& document_data = documents_.at(document_id);
+    const TermIds& document_terms = document_data.term_ids;
 
-    std::vector<std::string_view> matched_words(query.plus_words.size());
+    const auto contains = [&document_terms](TermId term_id) {
+        return std::binary_search(document_terms.begin(), document_terms.end(), term_id);
+    };
 
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(),
-            [this, document_id](std::string_view word) {
-                return document_to_word_freqs_.at(document_id).count(word);
-            })) { 
-        return { {}, documents_.at(document_id).status }; 
+    const auto minus_terms = FindTermIds(query.minus_words);
+    if (std::any_of(std::execution::par, minus_terms.begin(), minus_terms.end(), contains)) {
+        return {std::vector<std::string_view>{}, document_data.status};
     }
 
-    std::copy_if(std::execution::par, std::make_move_iterator(query.plus_words.begin()), std::make_move_iterator(query.plus_words.end()),
-            matched_words.begin(),
-            [this, document_id](std::string_view word) {
-                return (document_to_word_freqs_.at(document_id).count(word));
-        });
+    const auto plus_terms = FindTermIds(query.plus_words);
+    std::vector<TermId> matched_terms(plus_terms.size());
+    matched_terms.erase(std::copy_if(std::execution::par, plus_terms.begin(), plus_terms.end(), matched_terms.begin(), contains),
+                        matched_terms.end());
 
+    std::vector<std::string_view> matched_words(matched_terms.size());
+    std::transform(std::execution::par, matched_terms.begin(), matched_terms.end(), matched_words.begin(),
+        [this](TermId term_id) {
+            return terms_[term_id];
+        });
     std::sort(std::execution::par, matched_words.begin(), matched_words.end());
-    auto it = std::unique(std::execution::par, matched_words.begin(), matched_words.end());
 
-    return { {matched_words.begin(), it - 1}, SearchServer::documents_.at(document_id).status };
+    return {matched_words, document_data.status};
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const {
-    using namespace std::string_literals;
+std::vector<SearchServer::MatchResult> SearchServer::MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
 
-    const auto query = ParseQuery(raw_query);
+std::vector<SearchServer::MatchResult> SearchServer::MatchDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const {
+    const auto query_terms = FindQueryTerms(ParseQuery(raw_query));
 
-    std::vector<std::string_view> matched_words;
+    std::vector<MatchResult> results;
+    results.reserve(document_ids.size());
+    for (int document_id : document_ids) {
+        results.push_back(MatchTerms(query_terms, documents_.at(document_id)));
+    }
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
+    return results;
+}
 
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return { {}, documents_.at(document_id).status};
-        }
-    }
+std::vector<SearchServer::MatchResult> SearchServer::MatchDocuments(const std::execution::parallel_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const {
+    const auto query_terms = FindQueryTerms(ParseQuery(raw_query));
 
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
+    std::vector<const DocumentData*> documents(document_ids.size());
+    std::transform(document_ids.begin(), document_ids.end(), documents.begin(),
+        [this](int document_id) {
+            return &documents_.at(document_id);
+        });
 
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
-        }
-    }
+    std::vector<MatchResult> results(document_ids.size());
+    std::transform(std::execution::par, documents.begin(), documents.end(), results.begin(),
+        [this, &query_terms](const DocumentData* document_data) {
+            return MatchTerms(query_terms, *document_data);
+        });
 
-    return {matched_words, documents_.at(document_id).status};
+    return results;
 }
 
 SearchServer::Query SearchServer::ParseQueryExecPol(std::string_view text) const {
+    PERF_SCOPE("parse_query");
     Query result;
     std::vector<std::string_view> buff_text = SplitIntoWords(text);
 
     for (std::string_view word : buff_text) {
         const auto query_word = ParseQueryWord(word); //move()
 
-        if (!query_word.is_stop) {
+        if (query_word.is_prefix) {
+            auto& words = query_word.is_minus ? result.minus_words : result.plus_words;
+            const auto expansion = ExpandPrefix(query_word.data);
+            words.insert(words.end(), expansion.begin(), expansion.end());
+        } else if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 result.minus_words.push_back(std::move(query_word.data));
             } else {
@@ -219,14 +614,19 @@ SearchServer::Query SearchServer::ParseQueryExecPol(std::string_view text) const
     return result;
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
+SearchServer::Query SearchServer::ParseQuery(std::string_view text, const PrefixExpansions* prefix_expansions) const {
+    PERF_SCOPE("parse_query");
     Query result;
     std::vector<std::string_view> buff_text = SplitIntoWords(text);
 
     for (std::string_view word: buff_text) {
         const auto query_word = ParseQueryWord(word);
 
-        if (!query_word.is_stop) {
+        if (query_word.is_prefix) {
+            auto& words = query_word.is_minus ? result.minus_words : result.plus_words;
+            const auto expansion = ExpandPrefix(query_word.data, prefix_expansions);
+            words.insert(words.end(), expansion.begin(), expansion.end());
+        } else if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 result.minus_words.push_back(query_word.data);
             } else {
@@ -251,53 +651,79 @@ void SearchServer::RemoveDocument(int document_id) {
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
-        if (document_ids_.count(document_id)) {
-            const std::map<std::string_view, double>& word_freqs = document_to_word_freqs_.at(document_id);
-            
-            std::vector<std::string_view> words(word_freqs.size());
-            
-            std::transform(std::execution::seq, word_freqs.begin(), word_freqs.end(), words.begin(),
-                [](const std::pair<std::string_view, double>& item) {
-                    return item.first;
-                });
-
-            std::for_each(std::execution::seq, words.begin(), words.end(),
-                [this, document_id](std::string_view word) {
-                    word_to_document_freqs_.at(word).erase(document_id);
-                });
-                
-            documents_.erase(document_id);
-            
-            document_ids_.erase(document_id);
+    PERF_SCOPE("remove_document");
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end()) {
+        return;
+    }
+
+    const TermIds& term_ids = it->second.term_ids;
+    for (TermId term_id : term_ids) {
+        --term_postings_[term_id]->document_count;
     }
+    RemoveDocumentData(it);
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
-        if (document_ids_.count(document_id)) {
-            const std::map<std::string_view, double>& word_freqs = document_to_word_freqs_.at(document_id);
-            
-            std::vector<std::string> words(word_freqs.size());
-            
-            std::transform(std::execution::par, word_freqs.begin(), word_freqs.end(), words.begin(),
-                [](const std::pair<std::string_view, double>& item) {
-                    return item.first;
-                });
-
-            std::for_each(std::execution::par, words.begin(), words.end(),
-                [this, document_id](std::string_view word) {
-                    word_to_document_freqs_.at(word).erase(document_id);
-                });
-                
-            documents_.erase(document_id);
-            
-            document_ids_.erase(document_id);
+    PERF_SCOPE("remove_document");
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end()) {
+        return;
     }
+
+    // The terms of a document are distinct, so every task owns its counter.
+    const TermIds& term_ids = it->second.term_ids;
+    std::for_each(std::execution::par, term_ids.begin(), term_ids.end(),
+        [this](TermId term_id) {
+            --term_postings_[term_id]->document_count;
+        });
+    RemoveDocumentData(it);
 }
 
+void SearchServer::RemoveDocumentData(Documents::iterator it) {
+    const int document_id = it->first;
+    const TermIds& term_ids = it->second.term_ids;
+    removed_terms_.insert(removed_terms_.end(), term_ids.begin(), term_ids.end());
+    removed_documents_.Add(document_id);
 
+    status_documents_[static_cast<size_t>(it->second.status)].Remove(document_id);
+    documents_.erase(it);
+    document_to_word_freqs_.erase(document_id);
+    document_ids_.erase(document_id);
+    ++epoch_;
 
+    if (removed_documents_.GetCount() > documents_.size()) {
+        Compact();
+    }
+}
 
+void SearchServer::Compact() {
+    if (removed_documents_.IsEmpty()) {
+        return;
+    }
 
+    std::sort(removed_terms_.begin(), removed_terms_.end());
+    removed_terms_.erase(std::unique(removed_terms_.begin(), removed_terms_.end()), removed_terms_.end());
 
+    // Posting lists are separate maps, so they are purged concurrently.
+    std::for_each(std::execution::par, removed_terms_.begin(), removed_terms_.end(),
+        [this](TermId term_id) {
+            Postings& postings = term_postings_[term_id]->postings;
+            for (auto it = postings.begin(); it != postings.end();) {
+                it = removed_documents_.Contains(it->first) ? postings.erase(it) : std::next(it);
+            }
+        });
 
+    for (TermId term_id : removed_terms_) {
+        if (term_postings_[term_id]->postings.empty()) {
+            word_to_document_freqs_.erase(terms_[term_id]);
+            term_postings_[term_id] = nullptr;
+        }
+    }
 
+    removed_terms_.clear();
+    removed_terms_.shrink_to_fit();
+    removed_documents_.Clear();
+    // Prepared queries point into the purged posting lists.
+    ++epoch_;
+}
@@ -1,25 +1,127 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <vector>
 #include <execution>
 
 #include "concurrent_map.h"
+#include "counting_allocator.h"
 #include "document.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
 #include "log_duration.h"
+#include "memory_stats.h"
+#include "perf_profile.h"
 #include "string_processing.h"
 
 #define EPSILON 1e-6
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
+// A query word such as "cat*" stands for the indexed words that start with
+// "cat". When there are more, only those in the most documents are used
+// (equally frequent ones in lexicographic order), which bounds the work a
+// short prefix can cause.
+const size_t MAX_PREFIX_EXPANSION = 64;
+
+// Picks the words a prefix stands for from its candidates, which come in
+// lexicographic order with their document counts.
+std::vector<std::string_view> SelectPrefixExpansion(std::vector<std::pair<std::string_view, int>> candidates);
+
+// Result order: relevance, then rating, then id, so that ties are
+// deterministic and results from several indexes can be merged.
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        if (lhs.rating == rhs.rating) {
+            return lhs.id < rhs.id;
+        }
+        return lhs.rating > rhs.rating;
+    } else {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+// Keeps the `limit` most relevant of the documents pushed into it in a
+// bounded heap whose top is the least relevant one.
+class TopDocuments {
+public:
+    // The counter, if any, accounts for the heap.
+    explicit TopDocuments(size_t limit, AllocationCounter* counter = nullptr)
+        : limit_(limit)
+        , heap_(CountingAllocator<Document>(counter)) {
+    }
+
+    void Push(const Document& document) {
+        if (heap_.size() < limit_) {
+            heap_.push_back(document);
+            std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        } else if (limit_ > 0 && IsMoreRelevant(document, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+            heap_.back() = document;
+            std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        }
+    }
+
+    // Sorted by IsMoreRelevant; leaves the heap empty.
+    std::vector<Document> Extract() {
+        std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        std::vector<Document> documents(heap_.begin(), heap_.end());
+        heap_.clear();
+        return documents;
+    }
+
+private:
+    size_t limit_;
+    std::vector<Document, CountingAllocator<Document>> heap_;
+};
+
+// The words each prefix of a query stands for, keyed by the prefix without
+// its '*'. A sharded index picks them from corpus-wide document counts, so
+// that every shard expands a prefix to the same words.
+using PrefixExpansions = std::map<std::string, std::vector<std::string>, std::less<>>;
+
+// Statistics that IDF is computed from. A sharded index gathers them from
+// every shard, so that all shards score with corpus-wide values.
+struct CorpusStatistics {
+    int document_count = 0;
+    std::map<std::string, int, std::less<>> document_freqs;
+    PrefixExpansions prefix_expansions;
+};
+
+// Limits of one query, see SearchServer::FindTopDocumentsWithin.
+struct QueryBudget {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point deadline = Clock::time_point::max();
+    // Postings of plus words to read.
+    size_t max_postings = SIZE_MAX;
+};
+
+struct BudgetedDocuments {
+    std::vector<Document> documents;
+    // The budget ran out. Documents are scored in id order, so the results
+    // are the best of the documents below some id, with exact relevance.
+    bool is_partial = false;
+};
+
 class SearchServer {
 public:
+    using WordFrequencies = std::map<std::string_view, double, std::less<std::string_view>,
+                                     CountingAllocator<std::pair<const std::string_view, double>>>;
+    using DocumentIds = std::set<int, std::less<int>, CountingAllocator<int>>;
+
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
 
@@ -29,6 +131,12 @@ public:
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Throws std::invalid_argument if AddDocument would reject the status or
+    // a word of the document, without changing the index.
+    void CheckDocument(std::string_view document, DocumentStatus status) const;
+
+    bool HasDocument(int document_id) const;
+
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const ;
@@ -41,33 +149,190 @@ public:
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const ;
 
+    // Page `page` (counted from 0) of `page_size` results, in the order of
+    // FindTopDocuments but without its cap. Only the best
+    // (page + 1) * page_size candidates are kept, in a bounded heap.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size, DocumentStatus status) const;
+    std::vector<Document> FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size) const;
+
+    // Up to page_size results that rank after `last`, the last document of
+    // the previous page. Resuming from this cursor keeps a heap of one page
+    // however deep the caller goes.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsAfter(std::string_view raw_query, const Document& last, size_t page_size, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocumentsAfter(std::string_view raw_query, const Document& last, size_t page_size, DocumentStatus status) const;
+    std::vector<Document> FindTopDocumentsAfter(std::string_view raw_query, const Document& last, size_t page_size) const;
+
+    // Answers many queries at once, term-at-a-time. The batch is cut into
+    // windows; within a window every distinct word is looked up and its
+    // posting list traversed once, scattering contributions into per-query
+    // accumulators. Windows run in parallel. Results are the same as those of
+    // FindTopDocuments for each query.
+    template <typename DocumentPredicate>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, DocumentPredicate document_predicate) const;
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, DocumentStatus status) const;
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const;
+
+    // Stops scoring once the budget is spent and returns the best documents
+    // found so far. The deadline is checked every DEADLINE_CHECK_INTERVAL
+    // documents, so it may be overrun by that much work.
+    template <typename DocumentPredicate>
+    BudgetedDocuments FindTopDocumentsWithin(std::string_view raw_query, const QueryBudget& budget, DocumentPredicate document_predicate) const;
+    BudgetedDocuments FindTopDocumentsWithin(std::string_view raw_query, const QueryBudget& budget, DocumentStatus status) const;
+    BudgetedDocuments FindTopDocumentsWithin(std::string_view raw_query, const QueryBudget& budget) const;
+
+    // Postings the query reads, those of its minus words included. Cheap:
+    // the query is parsed and its words looked up, nothing is scored.
+    size_t EstimateQueryCost(std::string_view raw_query) const;
+
+    // Local document count and document frequencies of the query's plus words.
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query) const;
+    // The same with the query's prefixes expanded to the given words.
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query, const PrefixExpansions& prefix_expansions) const;
+
+    // Indexed words with the prefix that are in live documents, with the
+    // number of those documents, in lexicographic order.
+    std::vector<std::pair<std::string_view, int>> GetPrefixCandidates(std::string_view prefix) const;
+
+    // Scores with IDF computed from the given statistics instead of the local
+    // ones, and expands prefixes to the words of statistics.prefix_expansions.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status) const;
+
+    // Query compiled against the current index, see PrepareQuery.
+    class PreparedQuery;
+
+    // Parses the query once and resolves its words to posting lists and IDF,
+    // so that repeated executions skip parsing and word lookups. The plan is
+    // valid until the next AddDocument or RemoveDocument.
+    PreparedQuery PrepareQuery(std::string_view raw_query) const;
+
+    bool IsPreparedQueryCurrent(const PreparedQuery& query) const;
+
+    // Throws std::invalid_argument if the plan is stale or was prepared by
+    // another server.
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
+
     int GetDocumentCount() const;
 
-    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
-    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const;
-    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
+    using MatchResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+    // The matched words are sorted and point into the index, not into the query.
+    MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+    MatchResult MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const;
+    MatchResult MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
+    MatchResult MatchDocument(std::string_view raw_query, const PrefixExpansions& prefix_expansions, int document_id) const;
+
+    // Matches one query against many documents, parsing it once.
+    std::vector<MatchResult> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
+    std::vector<MatchResult> MatchDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const;
+    std::vector<MatchResult> MatchDocuments(const std::execution::parallel_policy&, std::string_view raw_query, const std::vector<int>& document_ids) const;
     
-    std::set<int>::iterator begin();
+    DocumentIds::iterator begin();
+
+    DocumentIds::iterator end();
 
-    std::set<int>::iterator end();
+    const WordFrequencies& GetWordFrequencies(int document_id) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Heap footprint of every internal structure.
+    MemoryStats GetMemoryStats() const;
     
+    // Removal leaves a tombstone: the document disappears from results and
+    // from document frequencies at once, while its postings stay until the
+    // next compaction. The parallel version updates the frequencies of the
+    // document's words in parallel.
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
+    // Drops the postings of removed documents, visiting the affected words in
+    // parallel. Runs by itself once removed documents outnumber live ones,
+    // and before an id that is still tombstoned is added again.
+    void Compact();
+
 private:
+    // Writes the read-only flat layout, see flat_index.h.
+    friend std::string SerializeIndex(const SearchServer& search_server, uint64_t generation);
+    // Writes the rebuildable image, see snapshot.h.
+    friend std::string SerializeSnapshot(const SearchServer& search_server, uint64_t sequence);
+
+    using TermId = uint32_t;
+
+    template <typename T>
+    using Allocator = CountingAllocator<T>;
+    using String = std::basic_string<char, std::char_traits<char>, Allocator<char>>;
+    using TermIds = std::vector<TermId, Allocator<TermId>>;
+    using Postings = std::map<int, double, std::less<int>, Allocator<std::pair<const int, double>>>;
+
+    struct PostingList {
+        Postings postings;
+        // Live documents in postings; the others are removed ones awaiting
+        // Compact. IDF is computed from this count.
+        int document_count = 0;
+    };
+
     struct DocumentData {
         int rating;
         DocumentStatus status;
-        std::string document_words;
+        String document_words;
+        // Forward index: sorted ids of the distinct words of the document.
+        TermIds term_ids;
     };
+
+    using Documents = std::map<int, DocumentData, std::less<int>, Allocator<std::pair<const int, DocumentData>>>;
+
+    // One counter per structure reported by GetMemoryStats. Heap-allocated
+    // so that the allocators keep pointing at it when the server is moved.
+    struct MemoryCounters {
+        AllocationCounter term_dictionary;
+        AllocationCounter word_to_document_freqs;
+        AllocationCounter document_to_word_freqs;
+        AllocationCounter documents;
+        AllocationCounter document_texts;
+        AllocationCounter forward_index;
+        AllocationCounter document_ids;
+        AllocationCounter status_bitmaps;
+        AllocationCounter removed_documents;
+        // Transient: merge cursors, accumulated relevance and top heaps of
+        // the queries in flight.
+        AllocationCounter query_scratch;
+    };
+    std::unique_ptr<MemoryCounters> memory_counters_ = std::make_unique<MemoryCounters>();
+
     const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
+    // Bumped by every mutation; prepared queries remember the value they saw.
+    uint64_t epoch_ = 0;
+    // Term dictionary. Owns every indexed word; the string_view keys below
+    // point here, so they stay valid when the document that introduced a
+    // word is removed.
+    std::map<String, TermId, std::less<>, Allocator<std::pair<const String, TermId>>> term_ids_{
+        Allocator<std::pair<const String, TermId>>(&memory_counters_->term_dictionary)};
+    std::vector<std::string_view, Allocator<std::string_view>> terms_{
+        Allocator<std::string_view>(&memory_counters_->term_dictionary)};
+    std::map<std::string_view, PostingList, std::less<std::string_view>, Allocator<std::pair<const std::string_view, PostingList>>> word_to_document_freqs_{
+        Allocator<std::pair<const std::string_view, PostingList>>(&memory_counters_->word_to_document_freqs)};
+    // Posting list of every term by TermId, null if it has none, so that
+    // RemoveDocument reaches them from the forward index without lookups.
+    std::vector<PostingList*, Allocator<PostingList*>> term_postings_{
+        Allocator<PostingList*>(&memory_counters_->word_to_document_freqs)};
+    std::map<int, WordFrequencies, std::less<int>, Allocator<std::pair<const int, WordFrequencies>>> document_to_word_freqs_{
+        Allocator<std::pair<const int, WordFrequencies>>(&memory_counters_->document_to_word_freqs)};
+    Documents documents_{Allocator<std::pair<const int, DocumentData>>(&memory_counters_->documents)};
+    DocumentIds document_ids_{Allocator<int>(&memory_counters_->document_ids)};
+    // Ids of the documents of every status, indexed by DocumentStatus.
+    std::array<DocumentBitmap, 4> status_documents_{
+        DocumentBitmap(&memory_counters_->status_bitmaps), DocumentBitmap(&memory_counters_->status_bitmaps),
+        DocumentBitmap(&memory_counters_->status_bitmaps), DocumentBitmap(&memory_counters_->status_bitmaps)};
+    // Tombstones: removed documents that still have postings.
+    DocumentBitmap removed_documents_{&memory_counters_->removed_documents};
+    // Terms with postings of removed documents, possibly repeated.
+    std::vector<TermId, Allocator<TermId>> removed_terms_{Allocator<TermId>(&memory_counters_->removed_documents)};
 
     bool IsStopWord(std::string_view word) const ;
 
@@ -81,24 +346,151 @@ private:
 
     QueryWord ParseQueryWord(std::string_view text) const ;
 
+    // Indexed words with the prefix that are in live documents, at most
+    // MAX_PREFIX_EXPANSION of them, found by a range scan of the ordered
+    // term dictionary.
+    std::vector<std::string_view> ExpandPrefix(std::string_view prefix) const;
+    // Looks the prefix up in prefix_expansions if given; a prefix missing
+    // from it is expanded locally.
+    std::vector<std::string_view> ExpandPrefix(std::string_view prefix, const PrefixExpansions* prefix_expansions) const;
+
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
     };
 
-    Query ParseQuery(const std::string& text) const;
-    Query ParseQuery(std::string_view text) const;
+    Query ParseQuery(std::string_view text, const PrefixExpansions* prefix_expansions = nullptr) const;
     Query ParseQueryExecPol(std::string_view text) const;
 
+    struct QueryTerms {
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+    };
+
+    TermId AddTerm(std::string_view word);
+
+    // Tombstones the document once its document frequencies are updated.
+    void RemoveDocumentData(Documents::iterator it);
+
+    // Sorted ids of the indexed words; unknown words are dropped.
+    std::vector<TermId> FindTermIds(const std::vector<std::string_view>& words) const;
+    QueryTerms FindQueryTerms(const Query& query) const;
+
+    MatchResult MatchTerms(const QueryTerms& query_terms, const DocumentData& document_data) const;
+
     // Existence required
     double ComputeWordInverseDocumentFreq(std::string_view word) const ;
+    double ComputeWordInverseDocumentFreq(std::string_view word, const CorpusStatistics& statistics) const;
+
+    // Posting list of a plus word and the IDF it is scored with.
+    struct ScoredTerm {
+        std::string_view word;
+        const Postings* postings;
+        double inverse_document_freq;
+    };
+
+    // Plus words with non-empty postings, in the order of the query.
+    std::vector<ScoredTerm> FindScoredTerms(const Query& query, const CorpusStatistics* statistics) const;
+
+    // Documents that contain any of the words.
+    DocumentBitmap CollectDocuments(const std::vector<std::string_view>& words) const;
+
+    // Null for a value outside of DocumentStatus.
+    const DocumentBitmap* FindStatusDocuments(DocumentStatus status) const;
 
+    // Turns a predicate into a check of one document id that also rejects
+    // removed documents. AnyDocument and WithStatus get kernels that never
+    // touch documents_: a tombstone probe, skipped while there are none, and
+    // a probe of the status bitmap, which removed documents have left.
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    auto MakeDocumentFilter(DocumentPredicate document_predicate) const;
+
+    static constexpr int DEADLINE_CHECK_INTERVAL = 64;
+
+    // What a budgeted query has spent so far.
+    struct BudgetTracker {
+        const QueryBudget& budget;
+        int documents_until_check = 0;
+        bool is_exhausted = false;
+    };
+
+    // Calls visit(document_id, relevance) for every matched document, by
+    // ascending id, as soon as its relevance is complete. Excluded documents
+    // are skipped before they are scored or filtered. With a budget, scoring
+    // stops once it is spent. Needs memory for the terms only.
+    template <typename DocumentPredicate, typename Visitor>
+    void VisitRelevance(const std::vector<ScoredTerm>& plus_terms, const DocumentBitmap& excluded, DocumentPredicate document_predicate, Visitor visit,
+                        BudgetTracker* budget = nullptr) const;
+
+    using RelevanceList = std::vector<std::pair<int, double>, Allocator<std::pair<int, double>>>;
+
+    // Relevance by document id, ascending, collected from VisitRelevance.
+    template <typename DocumentPredicate>
+    RelevanceList AccumulateRelevance(const std::vector<ScoredTerm>& plus_terms, const DocumentBitmap& excluded, DocumentPredicate document_predicate,
+                                      BudgetTracker* budget = nullptr) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> ScoreDocuments(const std::vector<ScoredTerm>& plus_terms, const DocumentBitmap& excluded, DocumentPredicate document_predicate,
+                                         BudgetTracker* budget = nullptr) const;
+
+    static std::vector<Document> SelectTopDocuments(std::vector<Document> matched_documents);
+
+    // The `limit` best matches that pass is_candidate, sorted.
+    template <typename DocumentPredicate, typename CandidateFilter>
+    std::vector<Document> FindBestDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t limit, CandidateFilter is_candidate) const;
+
+    // Bounds the per-query accumulators that are alive at the same time.
+    static constexpr size_t BATCH_WINDOW_SIZE = 64;
+
+    // Scores queries [first, last) of the batch into results.
+    template <typename DocumentFilter>
+    void ScoreBatchWindow(const std::vector<Query>& queries, size_t first, size_t last, const DocumentFilter& document_filter,
+                          std::vector<std::vector<Document>>& results) const;
+
+    void CheckPreparedQuery(const PreparedQuery& query) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const CorpusStatistics* statistics = nullptr) const;
     template <typename DocumentPredicate, typename ExecutionPolicy>
     std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate) const;
 };
 
+class SearchServer::PreparedQuery {
+public:
+    // Plus words, sorted.
+    std::vector<std::string_view> GetPlusWords() const;
+
+private:
+    friend class SearchServer;
+
+    const SearchServer* search_server_ = nullptr;
+    uint64_t epoch_ = 0;
+    std::vector<ScoredTerm> plus_terms_;
+    // Documents with a minus word.
+    DocumentBitmap excluded_;
+};
+
+template <typename DocumentPredicate>
+auto SearchServer::MakeDocumentFilter(DocumentPredicate document_predicate) const {
+    using Traits = DocumentFilterTraitsOf<DocumentPredicate>;
+
+    if constexpr (Traits::is_any_document) {
+        const DocumentBitmap* removed_documents = removed_documents_.IsEmpty() ? nullptr : &removed_documents_;
+        return [removed_documents](int document_id) {
+            return !removed_documents || !removed_documents->Contains(document_id);
+        };
+    } else if constexpr (Traits::is_status_only) {
+        const DocumentBitmap* documents = FindStatusDocuments(document_predicate.status);
+        return [documents](int document_id) {
+            return documents && documents->Contains(document_id);
+        };
+    } else {
+        return [this, document_predicate](int document_id) {
+            const auto it = documents_.find(document_id);
+            return it != documents_.end() && static_cast<bool>(document_predicate(document_id, it->second.status, it->second.rating));
+        };
+    }
+}
+
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words)
     : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
@@ -114,55 +506,264 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
 
     const auto query = ParseQuery(raw_query);
 
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+    return SelectTopDocuments(FindAllDocuments(query, document_predicate));
+}
 
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentPredicate document_predicate) const {
+    const auto query = ParseQuery(raw_query, &statistics.prefix_expansions);
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
+    return SelectTopDocuments(FindAllDocuments(query, document_predicate, &statistics));
+}
 
-    return matched_documents;
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    CheckPreparedQuery(query);
+
+    return SelectTopDocuments(ScoreDocuments(query.plus_terms_, query.excluded_, document_predicate));
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
+BudgetedDocuments SearchServer::FindTopDocumentsWithin(std::string_view raw_query, const QueryBudget& budget, DocumentPredicate document_predicate) const {
+    const auto query = ParseQuery(raw_query);
 
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+    BudgetTracker tracker{budget};
+    auto documents = SelectTopDocuments(ScoreDocuments(FindScoredTerms(query, nullptr), CollectDocuments(query.minus_words), document_predicate, &tracker));
+    return {std::move(documents), tracker.is_exhausted};
+}
 
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
+template <typename DocumentPredicate>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, DocumentPredicate document_predicate) const {
+    // Parsed up front: an exception thrown inside a parallel algorithm
+    // would terminate the process.
+    std::vector<Query> queries;
+    queries.reserve(raw_queries.size());
+    for (const std::string& raw_query : raw_queries) {
+        queries.push_back(ParseQuery(raw_query));
+    }
+
+    std::vector<size_t> window_starts;
+    for (size_t first = 0; first < queries.size(); first += BATCH_WINDOW_SIZE) {
+        window_starts.push_back(first);
+    }
+
+    const auto document_filter = MakeDocumentFilter(document_predicate);
+    std::vector<std::vector<Document>> results(queries.size());
+    std::for_each(std::execution::par, window_starts.begin(), window_starts.end(),
+        [this, &queries, &document_filter, &results](size_t first) {
+            ScoreBatchWindow(queries, first, std::min(first + BATCH_WINDOW_SIZE, queries.size()), document_filter, results);
+        });
+
+    return results;
+}
+
+template <typename DocumentFilter>
+void SearchServer::ScoreBatchWindow(const std::vector<Query>& queries, size_t first, size_t last, const DocumentFilter& document_filter,
+                                    std::vector<std::vector<Document>>& results) const {
+    // Positions within the window of the queries that use each word. Words
+    // are visited in lexicographic order, as FindAllDocuments visits the
+    // words of one query, so every sum is accumulated in the same order.
+    std::map<std::string_view, std::vector<size_t>> plus_word_queries;
+    std::map<std::string_view, std::vector<size_t>> minus_word_queries;
+    for (size_t i = first; i < last; ++i) {
+        for (std::string_view word : queries[i].plus_words) {
+            plus_word_queries[word].push_back(i - first);
+        }
+        for (std::string_view word : queries[i].minus_words) {
+            minus_word_queries[word].push_back(i - first);
+        }
+    }
 
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+    std::vector<DocumentBitmap> excluded(last - first);
+    for (const auto& [word, query_positions] : minus_word_queries) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end()) {
+            continue;
+        }
+        for (const auto [document_id, _] : it->second.postings) {
+            for (size_t position : query_positions) {
+                excluded[position].Add(document_id);
             }
         }
     }
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    // (document id, contribution) of every query, appended word by word. A
+    // stable sort by id then lines up the terms of each document in word
+    // order: contiguous appends instead of a tree node per document.
+    std::vector<std::vector<std::pair<int, double>>> contributions(last - first);
+    for (const auto& [word, query_positions] : plus_word_queries) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end() || it->second.document_count == 0) {
             continue;
         }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        for (const auto [document_id, term_freq] : it->second.postings) {
+            if (!document_filter(document_id)) {
+                continue;
+            }
+            const double contribution = term_freq * inverse_document_freq;
+            for (size_t position : query_positions) {
+                if (!excluded[position].Contains(document_id)) {
+                    contributions[position].emplace_back(document_id, contribution);
+                }
+            }
+        }
+    }
 
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+    for (size_t position = 0; position < last - first; ++position) {
+        auto& query_contributions = contributions[position];
+        std::stable_sort(query_contributions.begin(), query_contributions.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+        });
+        std::vector<Document> matched_documents;
+        for (auto it = query_contributions.begin(); it != query_contributions.end();) {
+            const int document_id = it->first;
+            double relevance = 0.0;
+            for (; it != query_contributions.end() && it->first == document_id; ++it) {
+                relevance += it->second;
+            }
+            matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
         }
+        // Frees the window's memory as it goes.
+        std::vector<std::pair<int, double>>().swap(query_contributions);
+        results[first + position] = SelectTopDocuments(std::move(matched_documents));
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const CorpusStatistics* statistics) const {
+    return ScoreDocuments(FindScoredTerms(query, statistics), CollectDocuments(query.minus_words), document_predicate);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPage(std::string_view raw_query, size_t page, size_t page_size, DocumentPredicate document_predicate) const {
+    if (page_size == 0) {
+        return {};
     }
+    const size_t first = page < SIZE_MAX / page_size ? page * page_size : SIZE_MAX;
+    const size_t limit = page + 1 < SIZE_MAX / page_size ? (page + 1) * page_size : SIZE_MAX;
 
-    std::vector<Document> matched_documents;
+    auto documents = FindBestDocuments(raw_query, document_predicate, limit, [](const Document&) {
+        return true;
+    });
+    documents.erase(documents.begin(), documents.begin() + std::min(first, documents.size()));
 
-    for (const auto [document_id, relevance] : document_to_relevance) {
+    return documents;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsAfter(std::string_view raw_query, const Document& last, size_t page_size, DocumentPredicate document_predicate) const {
+    return FindBestDocuments(raw_query, document_predicate, page_size, [&last](const Document& document) {
+        return IsMoreRelevant(last, document);
+    });
+}
+
+template <typename DocumentPredicate, typename CandidateFilter>
+std::vector<Document> SearchServer::FindBestDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t limit, CandidateFilter is_candidate) const {
+    const auto query = ParseQuery(raw_query);
+
+    // Matches go straight into the bounded heap, so memory follows the page
+    // and the number of terms, not the number of matches.
+    TopDocuments top_documents(limit, &memory_counters_->query_scratch);
+    VisitRelevance(FindScoredTerms(query, nullptr), CollectDocuments(query.minus_words), document_predicate,
+        [this, &top_documents, &is_candidate](int document_id, double relevance) {
+            const Document document(document_id, relevance, documents_.at(document_id).rating);
+            if (is_candidate(document)) {
+                top_documents.Push(document);
+            }
+        });
+
+    return top_documents.Extract();
+}
+
+template <typename DocumentPredicate, typename Visitor>
+void SearchServer::VisitRelevance(const std::vector<ScoredTerm>& plus_terms, const DocumentBitmap& excluded, DocumentPredicate document_predicate, Visitor visit,
+                                  BudgetTracker* budget) const {
+    PERF_SCOPE("score");
+    const auto document_filter = MakeDocumentFilter(document_predicate);
+    const bool has_excluded = !excluded.IsEmpty();
+
+    // Postings are sorted by id, so a k-way merge of the lists (a union for
+    // the words of an expanded prefix) visits every document once and needs
+    // no map node per document. Ties pop in the order of the terms, so every
+    // sum is accumulated in the same order as term-at-a-time scoring.
+    struct Cursor {
+        Postings::const_iterator position;
+        Postings::const_iterator end;
+        size_t term;
+    };
+    const auto is_after = [](const Cursor& lhs, const Cursor& rhs) {
+        if (lhs.position->first != rhs.position->first) {
+            return lhs.position->first > rhs.position->first;
+        }
+        return lhs.term > rhs.term;
+    };
+    std::vector<Cursor, Allocator<Cursor>> heap(Allocator<Cursor>(&memory_counters_->query_scratch));
+    heap.reserve(plus_terms.size());
+    for (size_t term = 0; term < plus_terms.size(); ++term) {
+        if (!plus_terms[term].postings->empty()) {
+            heap.push_back({plus_terms[term].postings->begin(), plus_terms[term].postings->end(), term});
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), is_after);
+
+    size_t postings = 0;
+    while (!heap.empty()) {
+        if (budget) {
+            if (postings >= budget->budget.max_postings) {
+                budget->is_exhausted = true;
+                break;
+            }
+            if (--budget->documents_until_check < 0) {
+                budget->documents_until_check = DEADLINE_CHECK_INTERVAL - 1;
+                if (QueryBudget::Clock::now() >= budget->budget.deadline) {
+                    budget->is_exhausted = true;
+                    break;
+                }
+            }
+        }
+        const int document_id = heap.front().position->first;
+        const bool is_matched = !(has_excluded && excluded.Contains(document_id)) && document_filter(document_id);
+        double relevance = 0.0;
+        do {
+            std::pop_heap(heap.begin(), heap.end(), is_after);
+            Cursor& cursor = heap.back();
+            if (is_matched) {
+                relevance += cursor.position->second * plus_terms[cursor.term].inverse_document_freq;
+            }
+            ++postings;
+            if (++cursor.position == cursor.end) {
+                heap.pop_back();
+            } else {
+                std::push_heap(heap.begin(), heap.end(), is_after);
+            }
+        } while (!heap.empty() && heap.front().position->first == document_id);
+        if (is_matched) {
+            visit(document_id, relevance);
+        }
+    }
+    PerfScope::AddPostings(postings);
+}
+
+template <typename DocumentPredicate>
+SearchServer::RelevanceList SearchServer::AccumulateRelevance(const std::vector<ScoredTerm>& plus_terms, const DocumentBitmap& excluded, DocumentPredicate document_predicate,
+                                                              BudgetTracker* budget) const {
+    RelevanceList document_to_relevance(Allocator<std::pair<int, double>>(&memory_counters_->query_scratch));
+    VisitRelevance(plus_terms, excluded, document_predicate, [&document_to_relevance](int document_id, double relevance) {
+        document_to_relevance.emplace_back(document_id, relevance);
+    }, budget);
+
+    return document_to_relevance;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::ScoreDocuments(const std::vector<ScoredTerm>& plus_terms, const DocumentBitmap& excluded, DocumentPredicate document_predicate,
+                                                   BudgetTracker* budget) const {
+    const auto document_to_relevance = AccumulateRelevance(plus_terms, excluded, document_predicate, budget);
+
+    std::vector<Document> matched_documents;
+    matched_documents.reserve(document_to_relevance.size());
+    for (const auto& [document_id, relevance] : document_to_relevance) {
         matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
     }
     
@@ -175,28 +776,12 @@ template <typename DocumentPredicate, typename ExecutionPolicy>
 
     const auto query = ParseQuery(raw_query);
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-
-    return matched_documents;
+    return SelectTopDocuments(FindAllDocuments(policy, query, document_predicate));
 }
 
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+    return FindTopDocuments(policy, raw_query, WithStatus{status});
 }
 
 template <typename ExecutionPolicy>
@@ -206,18 +791,25 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, s
 
 template <typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate) const {
+    // Only the calling thread is counted here, so the postings are reported
+    // by the per-word scopes of the tasks, on the threads that scan them.
+    PERF_SCOPE("score_par");
     ConcurrentMap<int, double> document_to_relevance(8);
+    const DocumentBitmap excluded = CollectDocuments(query.minus_words);
+    const auto document_filter = MakeDocumentFilter(document_predicate);
         
         for_each(
             policy,
             query.plus_words.begin(),
             query.plus_words.end(),
-            [this, &document_predicate, &document_to_relevance](std::string_view word) {
-                if (!word_to_document_freqs_.count(word) == 0) {
+            [this, &document_filter, &document_to_relevance, &excluded](std::string_view word) {
+                PERF_SCOPE("score_par_word");
+                const auto it = word_to_document_freqs_.find(word);
+                if (it != word_to_document_freqs_.end() && it->second.document_count > 0) {
+                    PerfScope::AddPostings(it->second.postings.size());
                     const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                    for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                        const auto& document_data = documents_.at(document_id);
-                        if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    for (const auto [document_id, term_freq] : it->second.postings) {
+                        if (!excluded.Contains(document_id) && document_filter(document_id)) {
                             document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
                         }
                     }
@@ -225,19 +817,6 @@ std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, c
             }
         );
 
-    for_each(
-            policy,
-            query.minus_words.begin(),
-            query.minus_words.end(),
-            [this, &document_predicate, &document_to_relevance](std::string_view word) {
-                if (!word_to_document_freqs_.count(word) == 0) {
-                    for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                        document_to_relevance.Erase(document_id);
-                    }
-                }
-            }
-        );
-        
         std::map<int, double> m_document_to_relevance(document_to_relevance.BuildOrdinaryMap());
         std::vector<Document> matched_documents;
         matched_documents.reserve(m_document_to_relevance.size());
@@ -0,0 +1,102 @@
+#include "sharded_search_server.h"
+
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words_text, size_t shard_count) {
+    using namespace std::string_literals;
+
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<SearchServer>(stop_words_text));
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    shards_[GetShardIndex(document_id)]->AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    shards_[GetShardIndex(document_id)]->RemoveDocument(document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const auto& shard : shards_) {
+        document_count += shard->GetDocumentCount();
+    }
+    return document_count;
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, WithStatus{status});
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::MatchResult ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return shards_[GetShardIndex(document_id)]->MatchDocument(raw_query, ExpandPrefixes(raw_query), document_id);
+}
+
+CorpusStatistics ShardedSearchServer::GetCorpusStatistics(std::string_view raw_query) const {
+    CorpusStatistics statistics;
+    statistics.prefix_expansions = ExpandPrefixes(raw_query);
+    for (const auto& shard : shards_) {
+        const CorpusStatistics shard_statistics = shard->GetCorpusStatistics(raw_query, statistics.prefix_expansions);
+        statistics.document_count += shard_statistics.document_count;
+        for (const auto& [word, document_freq] : shard_statistics.document_freqs) {
+            auto it = statistics.document_freqs.find(word);
+            if (it == statistics.document_freqs.end()) {
+                statistics.document_freqs.emplace(word, document_freq);
+            } else {
+                it->second += document_freq;
+            }
+        }
+    }
+    return statistics;
+}
+
+PrefixExpansions ShardedSearchServer::ExpandPrefixes(std::string_view raw_query) const {
+    PrefixExpansions prefix_expansions;
+    for (std::string_view word : SplitIntoWords(raw_query)) {
+        const auto [data, is_minus, is_prefix] = ParseQueryWordText(word);
+        if (!is_prefix || prefix_expansions.count(data) > 0) {
+            continue;
+        }
+
+        // Ordered by word, as SelectPrefixExpansion expects.
+        std::map<std::string_view, int> document_counts;
+        for (const auto& shard : shards_) {
+            for (const auto& [candidate, document_count] : shard->GetPrefixCandidates(data)) {
+                document_counts[candidate] += document_count;
+            }
+        }
+
+        std::vector<std::string>& words = prefix_expansions[std::string(data)];
+        for (std::string_view expansion : SelectPrefixExpansion({document_counts.begin(), document_counts.end()})) {
+            words.emplace_back(expansion);
+        }
+    }
+    return prefix_expansions;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    // Fibonacci hashing spreads strided ids evenly over the shards.
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ull;
+    return (hash >> 32) % shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t shard_index) const {
+    return *shards_.at(shard_index);
+}
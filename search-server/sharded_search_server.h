@@ -0,0 +1,78 @@
+#pragma once
+
+#include <execution>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Partitions documents over independent SearchServer shards by id hash.
+// A query is answered in two rounds: corpus statistics of the query words
+// are gathered from every shard and summed, then every shard runs
+// FindTopDocuments with these global statistics, so IDF and therefore the
+// relevance are the same as in a single index. The per-shard top
+// documents are merged with the usual result order.
+//
+// Prefixes are expanded once, before both rounds: the candidate words of
+// every shard are summed, the MAX_PREFIX_EXPANSION most frequent ones are
+// picked from these global counts, and every shard is given the same words.
+class ShardedSearchServer {
+public:
+    ShardedSearchServer(std::string_view stop_words_text, size_t shard_count);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    int GetDocumentCount() const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    SearchServer::MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    // Sums the statistics of all shards, with the prefixes expanded as in a
+    // single index. Throws if the query is invalid.
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query) const;
+
+    size_t GetShardCount() const;
+
+    size_t GetShardIndex(int document_id) const;
+
+    const SearchServer& GetShard(size_t shard_index) const;
+
+private:
+    std::vector<std::unique_ptr<SearchServer>> shards_;
+
+    // Expands the query's prefixes from the document counts of all shards.
+    PrefixExpansions ExpandPrefixes(std::string_view raw_query) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    // Gathered sequentially: it validates the query, and exceptions must not
+    // escape the parallel stage below.
+    const CorpusStatistics statistics = GetCorpusStatistics(raw_query);
+
+    std::vector<std::vector<Document>> shard_results(shards_.size());
+    std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_results.begin(),
+        [raw_query, &statistics, &document_predicate](const std::unique_ptr<SearchServer>& shard) {
+            return shard->FindTopDocuments(raw_query, statistics, document_predicate);
+        });
+
+    std::vector<Document> matched_documents;
+    for (const auto& documents : shard_results) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+
+    const size_t result_count = std::min<size_t>(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    std::partial_sort(matched_documents.begin(), matched_documents.begin() + result_count, matched_documents.end(), IsMoreRelevant);
+    matched_documents.resize(result_count);
+
+    return matched_documents;
+}
@@ -0,0 +1,130 @@
+#include "snapshot.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include "file_io.h"
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'S', 'S', 'S', 'N', 'A', 'P', '\0', '\0'};
+const uint32_t SNAPSHOT_VERSION = 1;
+// Magic, version, body checksum and body size.
+const size_t SNAPSHOT_HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+void AppendString(std::string& out, std::string_view text) {
+    AppendValue(out, static_cast<uint32_t>(text.size()));
+    out.append(text);
+}
+
+template <typename T>
+void Read(std::string_view& data, T& value) {
+    using namespace std::string_literals;
+    if (!ReadValue(data, value)) {
+        throw std::invalid_argument("Snapshot is truncated"s);
+    }
+}
+
+std::string_view ReadString(std::string_view& data) {
+    using namespace std::string_literals;
+    uint32_t size = 0;
+    Read(data, size);
+    if (data.size() < size) {
+        throw std::invalid_argument("Snapshot is truncated"s);
+    }
+    const std::string_view text = data.substr(0, size);
+    data.remove_prefix(size);
+    return text;
+}
+
+} // namespace
+
+std::string SerializeSnapshot(const SearchServer& search_server, uint64_t sequence) {
+    std::string body;
+    AppendValue(body, sequence);
+    AppendValue(body, static_cast<uint32_t>(search_server.stop_words_.size()));
+    for (const std::string& stop_word : search_server.stop_words_) {
+        AppendString(body, stop_word);
+    }
+    AppendValue(body, static_cast<uint64_t>(search_server.documents_.size()));
+    for (const auto& [document_id, document_data] : search_server.documents_) {
+        AppendValue(body, static_cast<int32_t>(document_id));
+        AppendValue(body, static_cast<uint8_t>(document_data.status));
+        AppendValue(body, static_cast<int32_t>(document_data.rating));
+        AppendString(body, document_data.document_words);
+    }
+
+    std::string out(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    AppendValue(out, SNAPSHOT_VERSION);
+    AppendValue(out, ComputeCrc32(body));
+    AppendValue(out, static_cast<uint64_t>(body.size()));
+    return out + body;
+}
+
+LoadedSnapshot DeserializeSnapshot(std::string_view data) {
+    using namespace std::string_literals;
+
+    if (data.size() < SNAPSHOT_HEADER_SIZE || data.substr(0, sizeof(SNAPSHOT_MAGIC)) != std::string_view(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))) {
+        throw std::invalid_argument("Not a snapshot"s);
+    }
+    data.remove_prefix(sizeof(SNAPSHOT_MAGIC));
+    uint32_t version = 0;
+    uint32_t checksum = 0;
+    uint64_t body_size = 0;
+    Read(data, version);
+    Read(data, checksum);
+    Read(data, body_size);
+    if (version != SNAPSHOT_VERSION) {
+        throw std::invalid_argument("Unsupported snapshot version "s + std::to_string(version));
+    }
+    if (data.size() != body_size || ComputeCrc32(data) != checksum) {
+        throw std::invalid_argument("Snapshot is corrupt"s);
+    }
+
+    uint64_t sequence = 0;
+    uint32_t stop_word_count = 0;
+    Read(data, sequence);
+    Read(data, stop_word_count);
+    std::vector<std::string_view> stop_words;
+    stop_words.reserve(stop_word_count);
+    for (uint32_t i = 0; i < stop_word_count; ++i) {
+        stop_words.push_back(ReadString(data));
+    }
+
+    LoadedSnapshot snapshot{SearchServer(stop_words), sequence};
+    uint64_t document_count = 0;
+    Read(data, document_count);
+    // The average rating is all the server keeps, and it is its own average.
+    std::vector<int> ratings(1);
+    for (uint64_t i = 0; i < document_count; ++i) {
+        int32_t document_id = 0;
+        uint8_t status = 0;
+        int32_t rating = 0;
+        Read(data, document_id);
+        Read(data, status);
+        Read(data, rating);
+        ratings[0] = rating;
+        snapshot.search_server.AddDocument(document_id, ReadString(data), static_cast<DocumentStatus>(status), ratings);
+    }
+    if (!data.empty()) {
+        throw std::invalid_argument("Snapshot has trailing data"s);
+    }
+    return snapshot;
+}
+
+void SaveSnapshot(const SearchServer& search_server, uint64_t sequence, const std::string& path) {
+    using namespace std::string_literals;
+
+    WriteFile(path + ".tmp"s, SerializeSnapshot(search_server, sequence));
+    RenameFile(path + ".tmp"s, path);
+    const size_t slash = path.rfind('/');
+    SyncDirectory(slash == std::string::npos ? "."s : path.substr(0, slash + 1));
+}
+
+std::optional<LoadedSnapshot> LoadSnapshot(const std::string& path) {
+    const auto data = ReadFile(path);
+    if (!data) {
+        return std::nullopt;
+    }
+    return DeserializeSnapshot(*data);
+}
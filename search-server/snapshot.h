@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "search_server.h"
+
+// Image of a server that it can be rebuilt from: the stop words and every
+// document with its status, average rating and text, plus the sequence
+// number of the last logged mutation it contains (see mutation_log.h).
+// Unlike the flat index it is a source of truth, not a read-only view.
+std::string SerializeSnapshot(const SearchServer& search_server, uint64_t sequence);
+
+struct LoadedSnapshot {
+    SearchServer search_server;
+    uint64_t sequence = 0;
+};
+
+// Throws std::invalid_argument if the data is truncated or corrupt.
+LoadedSnapshot DeserializeSnapshot(std::string_view data);
+
+// Replaces the file atomically: a crash leaves the old or the new snapshot.
+void SaveSnapshot(const SearchServer& search_server, uint64_t sequence, const std::string& path);
+
+// Nothing if the file does not exist.
+std::optional<LoadedSnapshot> LoadSnapshot(const std::string& path);
@@ -1,8 +1,47 @@
 
 #include "string_processing.h"
 
+#include <algorithm>
+#include <stdexcept>
 #include <string_view>
 
+bool IsValidWord(std::string_view word) {
+    return std::none_of(word.begin(), word.end(), [](char c) {
+        return c >= '\0' && c < ' ';
+    });
+}
+
+QueryWordText ParseQueryWordText(std::string_view word) {
+    using namespace std::string_literals;
+
+    if (word.empty()) {
+        throw std::invalid_argument("Query word is empty"s);
+    }
+
+    bool is_minus = false;
+
+    if (word[0] == '-') {
+        is_minus = true;
+        word = word.substr(1);
+    }
+
+    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+        throw std::invalid_argument("Query word "s + std::string(word) + " is invalid"s);
+    }
+
+    bool is_prefix = false;
+
+    if (word.back() == '*') {
+        is_prefix = true;
+        word.remove_suffix(1);
+        if (word.empty()) {
+            throw std::invalid_argument("Query prefix is empty"s);
+        }
+    }
+
+    return {word, is_minus, is_prefix};
+}
+
 std::vector<std::string> SplitIntoWords(const std::string& text) {
     std::vector<std::string> words;
 
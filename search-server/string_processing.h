@@ -2,6 +2,7 @@
 
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 template <typename StringContainer>
@@ -10,13 +11,28 @@ std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContain
 
     for (std::string_view str : strings) {
         if (!str.empty()) {
-            non_empty_strings.insert(str.data());
+            non_empty_strings.insert(std::string(str));
         }
     }
     
     return non_empty_strings;
 }
 
+// A valid word must not contain special characters.
+bool IsValidWord(std::string_view word);
+
+struct QueryWordText {
+    std::string_view data;
+    bool is_minus;
+    // The word ended with '*' and stands for every word that starts with data.
+    bool is_prefix;
+};
+
+// Strips the leading '-' of a minus word and the trailing '*' of a prefix.
+// Throws std::invalid_argument for empty words or prefixes, a double minus
+// and special characters.
+QueryWordText ParseQueryWordText(std::string_view word);
+
 std::vector<std::string> SplitIntoWords(const std::string& text);
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
\ No newline at end of file
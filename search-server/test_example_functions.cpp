@@ -0,0 +1,1418 @@
+#include "test_example_functions.h"
+
+#include "admission_controller.h"
+#include "corpus_generator.h"
+#include "document_bitmap.h"
+#include "document_file.h"
+#include "durable_search_server.h"
+#include "flat_index.h"
+#include "frozen_search_server.h"
+#include "mapped_index.h"
+#include "numa_search_server.h"
+#include "paginator.h"
+#include "perf_profile.h"
+#include "perfect_hash.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "test_framework.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::literals;
+
+namespace {
+
+std::vector<int> GetIds(const std::vector<Document>& documents) {
+    std::vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+// SearchServer is filled in place: its index points into its own storage.
+void AddAnimalDocuments(SearchServer& search_server) {
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::ACTUAL, {1, 2, 8});
+    search_server.AddDocument(4, "big dog cat Vladislav"s, DocumentStatus::IRRELEVANT, {1, 3, 2});
+    search_server.AddDocument(5, "big dog hamster Borya"s, DocumentStatus::BANNED, {1, 1, 1});
+}
+
+bool HaveSameResults(const std::vector<Document>& lhs, const std::vector<Document>& rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& lhs, const Document& rhs) {
+        return lhs.id == rhs.id && lhs.relevance == rhs.relevance && lhs.rating == rhs.rating;
+    });
+}
+
+}  // namespace
+
+void TestExcludeStopWordsFromAddedDocumentContent() {
+    const int doc_id = 42;
+    const std::string content = "cat in the city"s;
+    const std::vector<int> ratings = {1, 2, 3};
+    {
+        SearchServer server(""s);
+        server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
+        const auto found_docs = server.FindTopDocuments("in"s);
+        ASSERT_EQUAL(found_docs.size(), 1u);
+        ASSERT_EQUAL(found_docs[0].id, doc_id);
+    }
+    {
+        SearchServer server("in the"s);
+        server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
+        ASSERT_HINT(server.FindTopDocuments("in"s).empty(), "Stop words must be excluded from documents"s);
+    }
+    ASSERT_THROWS(SearchServer("in t\x12he"s), std::invalid_argument);
+}
+
+void TestMinusWordsExcludeDocuments() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("funny pet"s)).size(), 2u);
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("funny pet -rat"s)), std::vector<int>{2});
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments(std::execution::par, "funny pet -rat"s)), std::vector<int>{2});
+    ASSERT(search_server.FindTopDocuments("-funny"s).empty());
+    ASSERT_THROWS(search_server.FindTopDocuments("--funny"s), std::invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments("funny -"s), std::invalid_argument);
+}
+
+void TestMatchDocument() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    // The matched words may point into the query.
+    const std::string query = "nasty rat funny cat"s;
+    {
+        const auto [words, status] = search_server.MatchDocument(query, 1);
+        ASSERT_EQUAL(words, (std::vector<std::string_view>{"funny"sv, "nasty"sv, "rat"sv}));
+        ASSERT(status == DocumentStatus::ACTUAL);
+    }
+    {
+        const auto [words, status] = search_server.MatchDocument(std::execution::par, query, 1);
+        ASSERT_EQUAL(words, (std::vector<std::string_view>{"funny"sv, "nasty"sv, "rat"sv}));
+        ASSERT(status == DocumentStatus::ACTUAL);
+    }
+    {
+        const auto [words, status] = search_server.MatchDocument("nasty -rat"s, 1);
+        ASSERT(words.empty());
+    }
+    {
+        const auto [words, status] = search_server.MatchDocument(std::execution::par, "-rat"s, 2);
+        ASSERT(words.empty());
+    }
+    {
+        const auto [words, status] = search_server.MatchDocument("dog"sv, 5);
+        ASSERT_EQUAL(words, std::vector<std::string_view>{"dog"sv});
+        ASSERT(status == DocumentStatus::BANNED);
+    }
+}
+
+void TestMatchDocumentPoliciesAgree() {
+    CorpusOptions options;
+    options.vocabulary_size = 500;
+    options.document_length_median = 30;
+    const CorpusGenerator corpus(options);
+    SearchServer search_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(search_server, 0, 200);
+
+    QueryLogOptions query_options;
+    query_options.max_words = 12;
+    query_options.minus_ratio = 0.2;
+    QueryLogGenerator query_log(corpus, query_options);
+
+    std::vector<int> document_ids(search_server.begin(), search_server.end());
+    for (const std::string& query : query_log.Generate(50)) {
+        const auto batch = search_server.MatchDocuments(query, document_ids);
+        const auto par_batch = search_server.MatchDocuments(std::execution::par, query, document_ids);
+        ASSERT_EQUAL(batch.size(), document_ids.size());
+        ASSERT_EQUAL(par_batch.size(), document_ids.size());
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto [words, status] = search_server.MatchDocument(query, document_ids[i]);
+            const auto [par_words, par_status] = search_server.MatchDocument(std::execution::par, query, document_ids[i]);
+            ASSERT_EQUAL_HINT(words, par_words, query);
+            ASSERT(status == par_status);
+            ASSERT_EQUAL_HINT(std::get<0>(batch[i]), words, query);
+            ASSERT_EQUAL_HINT(std::get<0>(par_batch[i]), words, query);
+            ASSERT(std::is_sorted(words.begin(), words.end()));
+        }
+    }
+
+    // The words point into the index and outlive the query.
+    const auto [words, status] = search_server.MatchDocument(std::string(corpus.GenerateDocument(3).text), 3);
+    ASSERT(!words.empty());
+    ASSERT_THROWS(search_server.MatchDocument("cat"s, -1), std::out_of_range);
+}
+
+void TestSortByRelevanceAndRating() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    const auto documents = search_server.FindTopDocuments("funny nasty hair"s);
+    ASSERT_EQUAL(documents.size(), 3u);
+    for (size_t i = 1; i < documents.size(); ++i) {
+        ASSERT(documents[i - 1].relevance > documents[i].relevance - EPSILON);
+    }
+
+    SearchServer same_relevance(""s);
+    same_relevance.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    same_relevance.AddDocument(2, "cat"s, DocumentStatus::ACTUAL, {5});
+    same_relevance.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+    ASSERT_EQUAL(GetIds(same_relevance.FindTopDocuments("cat"s)), (std::vector<int>{2, 1}));
+}
+
+void TestComputeAverageRating() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {});
+    search_server.AddDocument(3, "rat"s, DocumentStatus::ACTUAL, {-5, -2});
+    ASSERT_EQUAL(search_server.FindTopDocuments("cat"s)[0].rating, 5);
+    ASSERT_EQUAL(search_server.FindTopDocuments("dog"s)[0].rating, 0);
+    ASSERT_EQUAL(search_server.FindTopDocuments("rat"s)[0].rating, -3);
+}
+
+void TestFilterByPredicateAndStatus() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big"s)), std::vector<int>{3});
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big"s, DocumentStatus::BANNED)), std::vector<int>{5});
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments(std::execution::par, "big"s, DocumentStatus::IRRELEVANT)), std::vector<int>{4});
+    const auto even = search_server.FindTopDocuments("big funny"s, [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    });
+    ASSERT_EQUAL(GetIds(even).size(), 2u);
+    for (const Document& document : even) {
+        ASSERT(document.id % 2 == 0);
+    }
+    ASSERT(search_server.FindTopDocuments("big"s, DocumentStatus::REMOVED).empty());
+}
+
+void TestSpecializedFilters() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+
+    for (const std::string& query : {"big cat"s, "funny nasty pet -rat"s, "dog hamster hair"s}) {
+        const auto any_lambda = [](int, DocumentStatus, int) {
+            return true;
+        };
+        ASSERT_EQUAL_HINT(GetIds(search_server.FindTopDocuments(query, AnyDocument{})),
+                          GetIds(search_server.FindTopDocuments(query, any_lambda)), query);
+        ASSERT_EQUAL_HINT(GetIds(search_server.FindTopDocuments(std::execution::par, query, AnyDocument{})),
+                          GetIds(search_server.FindTopDocuments(query, any_lambda)), query);
+        for (DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED}) {
+            const auto status_lambda = [status](int, DocumentStatus document_status, int) {
+                return document_status == status;
+            };
+            ASSERT_EQUAL_HINT(GetIds(search_server.FindTopDocuments(query, WithStatus{status})),
+                              GetIds(search_server.FindTopDocuments(query, status_lambda)), query);
+            ASSERT_EQUAL_HINT(GetIds(search_server.FindTopDocuments(std::execution::par, query, status)),
+                              GetIds(search_server.FindTopDocuments(query, status_lambda)), query);
+        }
+    }
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big"s, AnyDocument{})), (std::vector<int>{3, 4, 5}));
+    ASSERT(WithStatus{DocumentStatus::BANNED}(5, DocumentStatus::BANNED, 1));
+}
+
+void TestComputeRelevance() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(0, "white cat and fashion collar"s, DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(1, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    const auto documents = search_server.FindTopDocuments("fluffy groomed cat"s);
+    ASSERT_EQUAL(documents.size(), 3u);
+    // fluffy: tf = 2/4, idf = log(3); cat: tf = 1/4, idf = log(3/2).
+    const double expected = 0.5 * std::log(3.0) + 0.25 * std::log(1.5);
+    ASSERT_EQUAL(documents[0].id, 1);
+    ASSERT(std::abs(documents[0].relevance - expected) < EPSILON);
+}
+
+void TestRemoveDocument() {
+    for (int policy = 0; policy < 3; ++policy) {
+        SearchServer search_server("and with"s);
+        AddAnimalDocuments(search_server);
+        switch (policy) {
+            case 0:
+                search_server.RemoveDocument(1);
+                break;
+            case 1:
+                search_server.RemoveDocument(std::execution::seq, 1);
+                break;
+            default:
+                search_server.RemoveDocument(std::execution::par, 1);
+                break;
+        }
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 4);
+        ASSERT(search_server.GetWordFrequencies(1).empty());
+        // "rat" and "funny" were introduced by the removed document.
+        ASSERT(search_server.FindTopDocuments("rat"s).empty());
+        ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("funny"s)), std::vector<int>{2});
+        // Removing an unknown document is a no-op.
+        search_server.RemoveDocument(100);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 4);
+    }
+}
+
+void TestCompact() {
+    CorpusOptions options;
+    options.vocabulary_size = 500;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+
+    QueryLogOptions query_options;
+    query_options.max_words = 5;
+    query_options.minus_ratio = 0.1;
+    const auto queries = QueryLogGenerator(corpus, query_options).Generate(50);
+
+    SearchServer search_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(search_server, 0, 300);
+    SearchServer expected(corpus.GetStopWords());
+    corpus.ForEachDocument(0, 300, [&expected](const GeneratedDocument& document) {
+        if (document.id % 3 != 0) {
+            expected.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+    });
+
+    const auto is_even = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+    const auto check = [&](const SearchServer& search_server) {
+        const auto batch = search_server.FindTopDocumentsBatch(queries, AnyDocument{});
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const std::string& query = queries[i];
+            ASSERT_HINT(HaveSameResults(search_server.FindTopDocuments(query), expected.FindTopDocuments(query)), query);
+            ASSERT_HINT(HaveSameResults(search_server.FindTopDocuments(query, is_even), expected.FindTopDocuments(query, is_even)), query);
+            ASSERT_HINT(HaveSameResults(batch[i], expected.FindTopDocuments(query, AnyDocument{})), query);
+            ASSERT_HINT(HaveSameResults(search_server.FindTopDocuments(std::execution::par, query, AnyDocument{}), expected.FindTopDocuments(query, AnyDocument{})), query);
+            ASSERT_HINT(HaveSameResults(search_server.FindTopDocumentsPage(query, 1, 5, AnyDocument{}), expected.FindTopDocumentsPage(query, 1, 5, AnyDocument{})), query);
+        }
+    };
+
+    // A third of the documents is removed: too few for an automatic compaction.
+    for (int document_id = 0; document_id < 300; document_id += 3) {
+        if (document_id % 2 == 0) {
+            search_server.RemoveDocument(document_id);
+        } else {
+            search_server.RemoveDocument(std::execution::par, document_id);
+        }
+    }
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 200);
+    const MemoryStats tombstoned = search_server.GetMemoryStats();
+    ASSERT(tombstoned.removed_postings > 0);
+    ASSERT_EQUAL(tombstoned.orphaned_word_frequencies, 0u);
+    // Results and document frequencies match a server that never had them.
+    check(search_server);
+    const std::string serialized = SerializeIndex(search_server, 1);
+    const FlatIndex flat_index(serialized);
+    for (const std::string& query : queries) {
+        ASSERT_HINT(HaveSameResults(flat_index.FindTopDocuments(query), expected.FindTopDocuments(query)), query);
+    }
+
+    const auto prepared = search_server.PrepareQuery(queries[0]);
+    search_server.Compact();
+    ASSERT(!search_server.IsPreparedQueryCurrent(prepared));
+    ASSERT_EQUAL(search_server.GetMemoryStats().removed_postings, 0u);
+    check(search_server);
+
+    // A removed id can be reused, before and after compaction.
+    search_server.RemoveDocument(1);
+    expected.RemoveDocument(1);
+    for (SearchServer* server : {&search_server, &expected}) {
+        server->AddDocument(1, corpus.GenerateDocument(1'000).text, DocumentStatus::ACTUAL, {5});
+        server->AddDocument(3, corpus.GenerateDocument(1'001).text, DocumentStatus::ACTUAL, {5});
+    }
+    check(search_server);
+
+    // Removing most documents compacts by itself.
+    for (int document_id = 0; document_id < 300; ++document_id) {
+        search_server.RemoveDocument(document_id);
+    }
+    const MemoryStats emptied = search_server.GetMemoryStats();
+    ASSERT_EQUAL(emptied.removed_postings, 0u);
+    ASSERT_EQUAL(emptied.empty_postings, 0u);
+}
+
+void TestRemoveDuplicates() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+
+    std::ostringstream sink;
+    auto* const cout_buffer = std::cout.rdbuf(sink.rdbuf());
+    RemoveDuplicates(search_server);
+    std::cout.rdbuf(cout_buffer);
+
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+    ASSERT_EQUAL(std::vector<int>(search_server.begin(), search_server.end()), (std::vector<int>{1, 2, 6}));
+}
+
+void TestMemoryStats() {
+    const auto find = [](const MemoryStats& stats, const std::string& name) {
+        for (const StructureMemory& structure : stats.structures) {
+            if (structure.name == name) {
+                return structure;
+            }
+        }
+        AssertImpl(false, name, __FILE__, __FUNCTION__, __LINE__, "unknown structure"s);
+        return StructureMemory{};
+    };
+
+    SearchServer search_server("and with"s);
+    ASSERT_EQUAL(search_server.GetMemoryStats().total_bytes, 0u);
+
+    AddAnimalDocuments(search_server);
+    const MemoryStats stats = search_server.GetMemoryStats();
+    size_t total_bytes = 0;
+    for (const StructureMemory& structure : stats.structures) {
+        total_bytes += structure.bytes;
+    }
+    ASSERT_EQUAL(stats.total_bytes, total_bytes);
+    ASSERT_EQUAL(find(stats, "documents"s).elements, 5u);
+    ASSERT(find(stats, "documents"s).bytes > 0);
+    ASSERT_EQUAL(find(stats, "document_ids"s).elements, 5u);
+    // 12 distinct words in 20 (word, document) pairs.
+    ASSERT_EQUAL(find(stats, "term_dictionary"s).elements, 12u);
+    ASSERT_EQUAL(find(stats, "word_to_document_freqs"s).elements, 20u);
+    ASSERT_EQUAL(find(stats, "forward_index"s).elements, 20u);
+    ASSERT_EQUAL(stats.empty_postings, 0u);
+
+    // The allocators keep counting into the same place after a move.
+    SearchServer moved_server(std::move(search_server));
+    for (int document_id = 1; document_id <= 5; ++document_id) {
+        moved_server.RemoveDocument(document_id);
+    }
+    const MemoryStats after_removal = moved_server.GetMemoryStats();
+    ASSERT_EQUAL(find(after_removal, "documents"s).bytes, 0u);
+    ASSERT_EQUAL(find(after_removal, "document_texts"s).bytes, 0u);
+    ASSERT_EQUAL(find(after_removal, "forward_index"s).bytes, 0u);
+    ASSERT_EQUAL(find(after_removal, "document_ids"s).bytes, 0u);
+    ASSERT_EQUAL(find(after_removal, "word_to_document_freqs"s).elements, 0u);
+}
+
+void TestDocumentBitmap() {
+    AllocationCounter counter;
+    {
+        DocumentBitmap bitmap(&counter);
+        ASSERT(bitmap.IsEmpty());
+        // The first group outgrows the array form, the others stay sparse.
+        for (int document_id = 0; document_id < 10'000; ++document_id) {
+            bitmap.Add(document_id * 3);
+        }
+        bitmap.Add(1 << 20);
+        bitmap.Add(5);
+        bitmap.Add(5);
+        ASSERT_EQUAL(bitmap.GetCount(), 10'002u);
+        ASSERT(bitmap.Contains(29'997) && bitmap.Contains(5) && bitmap.Contains(1 << 20));
+        ASSERT(!bitmap.Contains(4) && !bitmap.Contains(29'998) && !bitmap.Contains((1 << 20) + 1));
+        ASSERT(counter.bytes.load() > 0);
+
+        for (int document_id = 0; document_id < 10'000; document_id += 2) {
+            bitmap.Remove(document_id * 3);
+        }
+        bitmap.Remove(4);
+        ASSERT_EQUAL(bitmap.GetCount(), 5'002u);
+        ASSERT(!bitmap.Contains(0) && bitmap.Contains(3) && bitmap.Contains(5));
+        ASSERT(bitmap.Contains(29'997));
+    }
+    ASSERT_EQUAL(counter.bytes.load(), 0u);
+
+    SearchServer search_server("and with"s);
+    ASSERT_THROWS(search_server.AddDocument(1, "cat"s, static_cast<DocumentStatus>(9), {1}), std::invalid_argument);
+    AddAnimalDocuments(search_server);
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big cat"s, DocumentStatus::BANNED)), std::vector<int>{5});
+    ASSERT(search_server.FindTopDocuments("big cat"s, static_cast<DocumentStatus>(9)).empty());
+    search_server.RemoveDocument(5);
+    ASSERT(search_server.FindTopDocuments("big cat"s, DocumentStatus::BANNED).empty());
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big cat -nasty"s)), std::vector<int>{});
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big cat -nasty"s, DocumentStatus::IRRELEVANT)), std::vector<int>{4});
+}
+
+void TestProcessQueries() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    const std::vector<std::string> queries = {"funny"s, "big -cat"s, "nothing"s};
+    const auto results = ProcessQueries(search_server, queries);
+    ASSERT_EQUAL(results.size(), 3u);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        ASSERT_EQUAL(GetIds(results[i]), GetIds(search_server.FindTopDocuments(queries[i])));
+    }
+    ASSERT_EQUAL(ProcessQueriesJoined(search_server, queries).size(), results[0].size() + results[1].size());
+}
+
+void TestProcessQueriesBatched() {
+    CorpusOptions options;
+    options.vocabulary_size = 1'000;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+    SearchServer search_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(search_server, 0, 300);
+
+    QueryLogOptions query_options;
+    query_options.max_words = 6;
+    query_options.minus_ratio = 0.2;
+    // Several windows, with repeated queries and shared words.
+    const auto queries = QueryLogGenerator(corpus, query_options).Generate(200);
+
+    const auto results = ProcessQueriesBatched(search_server, queries);
+    ASSERT_EQUAL(results.size(), queries.size());
+    const auto banned = search_server.FindTopDocumentsBatch(queries, DocumentStatus::BANNED);
+    const auto even_ids = search_server.FindTopDocumentsBatch(queries, [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    });
+    for (size_t i = 0; i < queries.size(); ++i) {
+        ASSERT_HINT(HaveSameResults(results[i], search_server.FindTopDocuments(queries[i])), queries[i]);
+        ASSERT_HINT(HaveSameResults(banned[i], search_server.FindTopDocuments(queries[i], DocumentStatus::BANNED)), queries[i]);
+        ASSERT_HINT(HaveSameResults(even_ids[i], search_server.FindTopDocuments(queries[i], [](int document_id, DocumentStatus, int) {
+            return document_id % 2 == 0;
+        })), queries[i]);
+    }
+
+    ASSERT(search_server.FindTopDocumentsBatch({}).empty());
+    ASSERT_THROWS(search_server.FindTopDocumentsBatch({"cat"s, "--bad"s}), std::invalid_argument);
+}
+
+void TestPrepareQuery() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+
+    const auto query = search_server.PrepareQuery("nasty pet pet cat -rat unknown and"s);
+    ASSERT(search_server.IsPreparedQueryCurrent(query));
+    ASSERT_EQUAL(query.GetPlusWords(), (std::vector<std::string_view>{"cat"sv, "nasty"sv, "pet"sv}));
+    ASSERT_EQUAL(search_server.PrepareQuery("big funny hamster cat"s).GetPlusWords(),
+                 (std::vector<std::string_view>{"big"sv, "cat"sv, "funny"sv, "hamster"sv}));
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments(query)), (std::vector<int>{3, 2}));
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT)), std::vector<int>{4});
+    ASSERT_THROWS(search_server.PrepareQuery("cat --rat"s), std::invalid_argument);
+
+    CorpusOptions options;
+    options.vocabulary_size = 1'000;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+    SearchServer corpus_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(corpus_server, 0, 300);
+    QueryLogOptions query_options;
+    query_options.minus_ratio = 0.15;
+    query_options.min_words = 10;
+    query_options.max_words = 30;
+    // Relevance is summed in the same order, so results are exactly equal.
+    for (const std::string& raw_query : QueryLogGenerator(corpus, query_options).Generate(100)) {
+        const auto prepared = corpus_server.PrepareQuery(raw_query);
+        ASSERT_HINT(HaveSameResults(corpus_server.FindTopDocuments(prepared), corpus_server.FindTopDocuments(raw_query)), raw_query);
+        ASSERT_HINT(HaveSameResults(corpus_server.FindTopDocuments(prepared, DocumentStatus::BANNED),
+                                    corpus_server.FindTopDocuments(raw_query, DocumentStatus::BANNED)), raw_query);
+    }
+    ASSERT_THROWS(corpus_server.FindTopDocuments(query), std::invalid_argument);
+
+    search_server.AddDocument(6, "nasty cat"s, DocumentStatus::ACTUAL, {5});
+    ASSERT(!search_server.IsPreparedQueryCurrent(query));
+    ASSERT_THROWS(search_server.FindTopDocuments(query), std::invalid_argument);
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments(search_server.PrepareQuery("nasty pet cat -rat"s))), (std::vector<int>{6, 3, 2}));
+
+    const auto after_add = search_server.PrepareQuery("cat"s);
+    search_server.RemoveDocument(6);
+    ASSERT(!search_server.IsPreparedQueryCurrent(after_add));
+}
+
+void TestPrefixQuery() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    search_server.AddDocument(6, "catalog of dogs"s, DocumentStatus::ACTUAL, {4});
+
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("cat*"s, AnyDocument{})), (std::vector<int>{6, 3, 4}));
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("do*"s, AnyDocument{})), (std::vector<int>{6, 4, 5}));
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big -cat*"s, AnyDocument{})), std::vector<int>{5});
+    // Stop words are only dropped as whole words.
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("wi*"s)), std::vector<int>{});
+    ASSERT(search_server.MatchDocument("cat* nasty"s, 3) == (SearchServer::MatchResult{{"cat"sv, "nasty"sv}, DocumentStatus::ACTUAL}));
+    ASSERT(search_server.MatchDocument(std::execution::par, "ca*"s, 6) == (SearchServer::MatchResult{{"catalog"sv}, DocumentStatus::ACTUAL}));
+    ASSERT_THROWS(search_server.FindTopDocuments("*"s), std::invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments("cat -*"s), std::invalid_argument);
+
+    CorpusOptions options;
+    options.vocabulary_size = 2'000;
+    const CorpusGenerator corpus(options);
+    SearchServer corpus_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(corpus_server, 0, 500);
+    const std::string serialized = SerializeIndex(corpus_server, 1);
+    const FlatIndex flat_index(serialized);
+
+    bool is_capped = false;
+    for (size_t i = 0; i < 100; ++i) {
+        const std::string& word = corpus.GetVocabulary()[i];
+        for (size_t length : {1, 3}) {
+            const std::string prefix = word.substr(0, length) + "*"s;
+            const auto expansion = corpus_server.PrepareQuery(prefix).GetPlusWords();
+            ASSERT(expansion.size() <= MAX_PREFIX_EXPANSION);
+            is_capped = is_capped || expansion.size() == MAX_PREFIX_EXPANSION;
+            if (expansion.empty()) {
+                ASSERT_HINT(corpus_server.FindTopDocuments(prefix).empty(), prefix);
+                continue;
+            }
+
+            // The same results as a query that lists the expansion.
+            std::string expanded_query;
+            for (std::string_view expanded_word : expansion) {
+                expanded_query += (expanded_query.empty() ? ""s : " "s) + std::string(expanded_word);
+            }
+            const auto expected = corpus_server.FindTopDocuments(expanded_query);
+            ASSERT_HINT(HaveSameResults(corpus_server.FindTopDocuments(prefix), expected), prefix);
+            ASSERT_HINT(HaveSameResults(corpus_server.FindTopDocuments(std::execution::par, prefix), expected), prefix);
+            ASSERT_HINT(HaveSameResults(flat_index.FindTopDocuments(prefix), expected), prefix);
+            ASSERT_HINT(HaveSameResults(flat_index.FindTopDocuments(word + " -"s + prefix, AnyDocument{}),
+                                        corpus_server.FindTopDocuments(word + " -"s + prefix, AnyDocument{})), prefix);
+        }
+    }
+    ASSERT(is_capped);
+}
+
+void TestQueryBudget() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    ASSERT_EQUAL(search_server.EstimateQueryCost("cat -rat"s), 3u);
+    ASSERT_EQUAL(search_server.EstimateQueryCost("big* unknown"s), 3u);
+
+    CorpusOptions options;
+    options.vocabulary_size = 1'000;
+    const CorpusGenerator corpus(options);
+    SearchServer corpus_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(corpus_server, 0, 500);
+    QueryLogOptions query_options;
+    query_options.min_words = 5;
+    query_options.max_words = 10;
+    query_options.minus_ratio = 0.1;
+    int partial_count = 0;
+    for (const std::string& query : QueryLogGenerator(corpus, query_options).Generate(50)) {
+        const auto unlimited = corpus_server.FindTopDocumentsWithin(query, QueryBudget{});
+        ASSERT_HINT(!unlimited.is_partial, query);
+        ASSERT_HINT(HaveSameResults(unlimited.documents, corpus_server.FindTopDocuments(query)), query);
+
+        QueryBudget budget;
+        budget.max_postings = corpus_server.EstimateQueryCost(query) / 4;
+        const auto partial = corpus_server.FindTopDocumentsWithin(query, budget, AnyDocument{});
+        partial_count += partial.is_partial;
+        // Scored documents have their full relevance.
+        for (const Document& document : partial.documents) {
+            const auto alone = corpus_server.FindTopDocuments(query, [&document](int document_id, DocumentStatus, int) {
+                return document_id == document.id;
+            });
+            ASSERT_HINT(HaveSameResults({document}, alone), query);
+        }
+
+        budget = {};
+        budget.deadline = QueryBudget::Clock::now() - 1ms;
+        const auto expired = corpus_server.FindTopDocumentsWithin(query, budget, DocumentStatus::ACTUAL);
+        ASSERT_HINT(expired.documents.empty() && (expired.is_partial || unlimited.documents.empty()), query);
+    }
+    ASSERT(partial_count > 40);
+    ASSERT_THROWS(corpus_server.FindTopDocumentsWithin("cat --dog"s, QueryBudget{}), std::invalid_argument);
+
+    AdmissionController controller(10, 1);
+    auto first = controller.Admit(6, 0s);
+    ASSERT(first && controller.GetInFlightCost() == 6u);
+    ASSERT(!controller.Admit(6, 0s));
+    ASSERT(!controller.Admit(6, 10ms));
+    {
+        auto small = controller.Admit(4, 0s);
+        ASSERT(small && controller.GetInFlightCost() == 10u);
+    }
+    ASSERT_EQUAL(controller.GetInFlightCost(), 6u);
+
+    // A waiting query admitted once the first one completes; the queue is
+    // full meanwhile, so even a query that fits is shed.
+    std::thread waiter([&controller] {
+        const auto ticket = controller.Admit(100, 10s);
+        ASSERT(ticket && ticket->GetCost() == 10u);
+    });
+    while (controller.GetQueueLength() == 0) {
+        std::this_thread::yield();
+    }
+    ASSERT(!controller.Admit(1, 1s));
+    first.reset();
+    waiter.join();
+    ASSERT_EQUAL(controller.GetInFlightCost(), 0u);
+    ASSERT_EQUAL(controller.GetAdmittedCount(), 3u);
+    ASSERT_EQUAL(controller.GetShedCount(), 3u);
+}
+
+void TestPerfProfile() {
+    const auto find_scope = [](const PerfProfile& profile, const std::string& name) -> const ScopeCounters* {
+        const auto it = std::find_if(profile.scopes.begin(), profile.scopes.end(), [&name](const ScopeCounters& scope) {
+            return scope.name == name;
+        });
+        return it == profile.scopes.end() ? nullptr : &*it;
+    };
+
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    ResetPerfProfile();
+    EnablePerfProfiling({"parse_query"s, "score"s, "score_par"s, "score_par_word"s, "sort"s});
+    search_server.FindTopDocuments("cat -rat"s);
+    search_server.FindTopDocuments(std::execution::par, "big pet"s);
+    search_server.RemoveDocument(5);
+    DisablePerfProfiling();
+    search_server.FindTopDocuments("cat"s);
+
+    PerfProfile profile = GetPerfProfile();
+    const ScopeCounters* score = find_scope(profile, "score"s);
+    ASSERT(score && score->calls == 1u);
+    // All postings of the plus words, filtered or not.
+    ASSERT_EQUAL(score->postings, 2u);
+    // The parallel query reports its postings from the per-word tasks.
+    const ScopeCounters* score_par = find_scope(profile, "score_par"s);
+    const ScopeCounters* score_par_word = find_scope(profile, "score_par_word"s);
+    ASSERT(score_par && score_par->calls == 1u && score_par->postings == 0u);
+    ASSERT(score_par_word && score_par_word->calls == 2u);
+    ASSERT_EQUAL(score_par_word->postings, 5u);
+    ASSERT(find_scope(profile, "parse_query"s) && find_scope(profile, "parse_query"s)->calls == 2u);
+    ASSERT(find_scope(profile, "sort"s) && find_scope(profile, "sort"s)->calls == 2u);
+    ASSERT(!find_scope(profile, "remove_document"s));
+    // Unavailable counters degrade to zeros rather than failing.
+    ASSERT_EQUAL(profile.has_counters, HasPerfCounters());
+    if (HasPerfCounters()) {
+        ASSERT(score->cycles > 0 && score->instructions > 0);
+    }
+    std::ostringstream out;
+    out << profile;
+    ASSERT(out.str().find("parse_query"s) != std::string::npos);
+
+    ResetPerfProfile();
+    EnablePerfProfiling();
+    search_server.RemoveDocument(std::execution::par, 4);
+    RemoveDuplicates(search_server);
+    DisablePerfProfiling();
+    profile = GetPerfProfile();
+    ASSERT(find_scope(profile, "remove_document"s) && find_scope(profile, "remove_document"s)->calls == 1u);
+    ASSERT(find_scope(profile, "remove_duplicates"s) && find_scope(profile, "remove_duplicates"s)->calls == 1u);
+
+    ResetPerfProfile();
+    ASSERT(GetPerfProfile().scopes.empty());
+}
+
+void TestShardedSearchServer() {
+    CorpusOptions options;
+    options.vocabulary_size = 1'000;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+
+    SearchServer search_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(search_server, 0, 300);
+
+    QueryLogOptions query_options;
+    query_options.max_words = 6;
+    query_options.minus_ratio = 0.15;
+    const auto queries = QueryLogGenerator(corpus, query_options).Generate(100);
+
+    for (size_t shard_count : {1u, 3u, 8u}) {
+        ShardedSearchServer sharded_server(corpus.GetStopWords(), shard_count);
+        corpus.ForEachDocument(0, 300, [&sharded_server](const GeneratedDocument& document) {
+            sharded_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        });
+        ASSERT_EQUAL(sharded_server.GetDocumentCount(), 300);
+
+        for (const std::string& query : queries) {
+            for (DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                const auto expected = search_server.FindTopDocuments(query, status);
+                const auto actual = sharded_server.FindTopDocuments(query, status);
+                ASSERT_EQUAL_HINT(GetIds(actual), GetIds(expected), query);
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    ASSERT_HINT(std::abs(actual[i].relevance - expected[i].relevance) < EPSILON, query);
+                }
+            }
+        }
+
+        sharded_server.RemoveDocument(0);
+        ASSERT_EQUAL(sharded_server.GetDocumentCount(), 299);
+        ASSERT_THROWS(sharded_server.FindTopDocuments("--bad"s), std::invalid_argument);
+    }
+
+    // 100 words start with "w". The first 64 are in three documents, two on
+    // shard 0 and one on shard 1; the others in two documents on shard 1, so
+    // shard 1 alone would rank them first.
+    SearchServer single_server(""s);
+    ShardedSearchServer sharded_server(""s, 2);
+    std::vector<int> shard_ids[2];
+    for (int id = 0; shard_ids[0].size() < 128 || shard_ids[1].size() < 136; ++id) {
+        shard_ids[sharded_server.GetShardIndex(id)].push_back(id);
+    }
+    size_t next_ids[2] = {};
+    const auto add_word = [&](int word, size_t shard_index) {
+        const int id = shard_ids[shard_index][next_ids[shard_index]++];
+        const std::string text = "w"s + std::to_string(word);
+        single_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 7});
+        sharded_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 7});
+    };
+    for (int word = 0; word < 100; ++word) {
+        for (size_t shard_index : word < 64 ? std::vector<size_t>{0, 0, 1} : std::vector<size_t>{1, 1}) {
+            add_word(word, shard_index);
+        }
+    }
+    for (const std::string& query : {"w*"s, "w1*"s, "w1* -w9*"s, "w* -w1*"s}) {
+        const auto expected = single_server.FindTopDocuments(query);
+        ASSERT_HINT(!expected.empty(), query);
+        ASSERT_HINT(HaveSameResults(sharded_server.FindTopDocuments(query), expected), query);
+    }
+    ASSERT(sharded_server.GetCorpusStatistics("w*"s).prefix_expansions.at("w"s).size() == MAX_PREFIX_EXPANSION);
+    const int rare_word_id = shard_ids[1].back();
+    ASSERT(sharded_server.MatchDocument("w*"s, rare_word_id) == single_server.MatchDocument("w*"s, rare_word_id));
+    ASSERT(std::get<0>(sharded_server.MatchDocument("w*"s, rare_word_id)).empty());
+}
+
+void TestPaginator() {
+    const std::vector<int> values = {1, 2, 3, 4, 5};
+    const auto pages = Paginate(values, 2);
+    ASSERT_EQUAL(pages.size(), 3u);
+    ASSERT_EQUAL(pages.begin()->size(), 2u);
+    ASSERT_EQUAL((pages.end() - 1)->size(), 1u);
+
+    const auto lazy_pages = PaginateLazily(values, 2);
+    ASSERT_EQUAL(lazy_pages.size(), 3u);
+    std::vector<size_t> page_sizes;
+    for (const auto& page : lazy_pages) {
+        page_sizes.push_back(page.size());
+    }
+    ASSERT_EQUAL(page_sizes, (std::vector<size_t>{2, 2, 1}));
+    ASSERT_EQUAL(*(*++lazy_pages.begin()).begin(), 3);
+    ASSERT_EQUAL(PaginateLazily(std::vector<int>{}, 3).size(), 0u);
+    ASSERT(PaginateLazily(std::vector<int>{}, 3).begin() == PaginateLazily(std::vector<int>{}, 3).end());
+}
+
+void TestPagedSearch() {
+    CorpusOptions options;
+    options.vocabulary_size = 200;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+    SearchServer search_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(search_server, 0, 300);
+
+    QueryLogOptions query_options;
+    query_options.max_words = 3;
+    query_options.minus_ratio = 0.1;
+    for (const std::string& query : QueryLogGenerator(corpus, query_options).Generate(30)) {
+        const auto all = search_server.FindTopDocumentsPage(query, 0, 1'000);
+        ASSERT_HINT(HaveSameResults(search_server.FindTopDocumentsPage(query, 0, MAX_RESULT_DOCUMENT_COUNT), search_server.FindTopDocuments(query)), query);
+        ASSERT_HINT(std::is_sorted(all.begin(), all.end(), IsMoreRelevant), query);
+
+        std::vector<Document> by_page;
+        std::vector<Document> by_cursor;
+        for (size_t page = 0; by_page.size() < all.size(); ++page) {
+            const auto documents = search_server.FindTopDocumentsPage(query, page, 7);
+            ASSERT(!documents.empty() && documents.size() <= 7u);
+            by_page.insert(by_page.end(), documents.begin(), documents.end());
+        }
+        auto documents = search_server.FindTopDocumentsPage(query, 0, 7);
+        while (!documents.empty()) {
+            by_cursor.insert(by_cursor.end(), documents.begin(), documents.end());
+            documents = search_server.FindTopDocumentsAfter(query, by_cursor.back(), 7);
+        }
+        ASSERT_HINT(HaveSameResults(by_page, all), query);
+        ASSERT_HINT(HaveSameResults(by_cursor, all), query);
+        ASSERT(search_server.FindTopDocumentsPage(query, all.size(), 1).empty());
+    }
+
+    // Scratch memory follows the page and the terms, not the matches.
+    const auto get_peak_scratch = [](int document_count) {
+        SearchServer server(""s);
+        for (int document_id = 0; document_id < document_count; ++document_id) {
+            server.AddDocument(document_id, document_id % 2 == 0 ? "cat dog"s : "cat bird"s, DocumentStatus::ACTUAL, {document_id % 7});
+        }
+        const auto first_page = server.FindTopDocumentsPage("cat dog bird"s, 0, 5);
+        ASSERT_EQUAL(server.FindTopDocumentsAfter("cat dog bird"s, first_page.back(), 5).size(), 5u);
+        return server.GetMemoryStats().peak_query_scratch_bytes;
+    };
+    const size_t small_peak_scratch = get_peak_scratch(100);
+    ASSERT(small_peak_scratch > 0);
+    ASSERT_EQUAL(get_peak_scratch(20'000), small_peak_scratch);
+
+    SearchServer animals("and with"s);
+    AddAnimalDocuments(animals);
+    ASSERT_EQUAL(GetIds(animals.FindTopDocumentsPage("big dog"s, 1, 1, DocumentStatus::IRRELEVANT)), std::vector<int>{});
+    ASSERT_EQUAL(GetIds(animals.FindTopDocumentsPage("big cat"s, 0, 0)), std::vector<int>{});
+    ASSERT_THROWS(animals.FindTopDocumentsPage("--cat"s, 0, 1), std::invalid_argument);
+}
+
+void TestRequestQueue() {
+    SearchServer search_server("and with"s);
+    AddAnimalDocuments(search_server);
+    RequestQueue request_queue(search_server);
+    for (int i = 0; i < 1439; ++i) {
+        request_queue.AddFindRequest("empty request"s);
+    }
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1439);
+    request_queue.AddFindRequest("funny pet"s);
+    request_queue.AddFindRequest("big"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1438);
+}
+
+void TestCorpusGenerator() {
+    CorpusOptions options;
+    options.vocabulary_size = 2'000;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+    const CorpusGenerator same_corpus(options);
+    ASSERT_EQUAL(corpus.GetVocabulary().size(), 2'000u);
+    ASSERT_EQUAL(corpus.GenerateDocument(17).text, same_corpus.GenerateDocument(17).text);
+    ASSERT(corpus.GenerateDocument(17).text != corpus.GenerateDocument(18).text);
+
+    SearchServer search_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(search_server, 0, 100);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 100);
+
+    std::ostringstream out;
+    corpus.WriteDocuments(out, 5, 3);
+    std::istringstream in(out.str());
+    std::string line;
+    int lines = 0;
+    while (std::getline(in, line)) {
+        ++lines;
+    }
+    ASSERT_EQUAL(lines, 3);
+
+    QueryLogGenerator queries(corpus);
+    QueryLogGenerator same_queries(corpus);
+    ASSERT_EQUAL(queries.Generate(10), same_queries.Generate(10));
+}
+
+void TestDocumentFile() {
+    CorpusOptions options;
+    options.vocabulary_size = 1'000;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+
+    SearchServer expected(corpus.GetStopWords());
+    corpus.AddDocumentsTo(expected, 0, 500);
+
+    QueryLogOptions query_options;
+    query_options.max_words = 5;
+    const auto queries = QueryLogGenerator(corpus, query_options).Generate(50);
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / ("search_server_documents_"s + std::to_string(getpid()));
+    for (DocumentFileFormat format : {DocumentFileFormat::TSV, DocumentFileFormat::JSONL}) {
+        {
+            std::ofstream out(path);
+            corpus.WriteDocuments(out, 0, 500, format);
+        }
+        IngestOptions ingest_options;
+        ingest_options.format = format;
+        // Small batches make the pipeline wrap around its queues many times.
+        ingest_options.batch_size = 7;
+        ingest_options.queue_capacity = 2;
+
+        SearchServer search_server(corpus.GetStopWords());
+        const IngestStats stats = IngestDocuments(search_server, path.string(), ingest_options);
+        ASSERT_EQUAL(stats.document_count, 500u);
+        ASSERT_EQUAL(stats.byte_count, static_cast<size_t>(std::filesystem::file_size(path)));
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 500);
+        for (const std::string& query : queries) {
+            ASSERT_HINT(HaveSameResults(search_server.FindTopDocuments(query, DocumentStatus::BANNED), expected.FindTopDocuments(query, DocumentStatus::BANNED)), query);
+            ASSERT_HINT(HaveSameResults(search_server.FindTopDocuments(query), expected.FindTopDocuments(query)), query);
+        }
+    }
+
+    const auto read_records = [&path](const std::string& content, DocumentFileFormat format) {
+        {
+            std::ofstream out(path);
+            out << content;
+        }
+        IngestOptions ingest_options;
+        ingest_options.format = format;
+        std::vector<DocumentRecord> records;
+        ReadDocumentFile(path.string(), ingest_options, [&records](const DocumentRecord& record) {
+            records.push_back(record);
+            records.back().text = {};
+        });
+        return records;
+    };
+
+    // Escapes are decoded, unknown keys skipped, missing fields defaulted.
+    std::string text;
+    {
+        std::ofstream out(path);
+        out << "{\"id\": 3, \"extra\": {\"a\": [1, \"x\"]}, \"text\": \"caf\\u00e9 \\\"cat\\\"\\tdog\"}\r\n"
+               "\n"
+               "{\"text\": \"plain\", \"ratings\": [-1, 5], \"status\": 2, \"id\": 4}"s;
+    }
+    IngestOptions json_options;
+    json_options.format = DocumentFileFormat::JSONL;
+    std::vector<DocumentRecord> records;
+    ReadDocumentFile(path.string(), json_options, [&records, &text](const DocumentRecord& record) {
+        records.push_back(record);
+        text += std::string(record.text) + "|"s;
+    });
+    ASSERT_EQUAL(records.size(), 2u);
+    ASSERT_EQUAL(records[0].id, 3);
+    ASSERT_EQUAL(records[0].status, DocumentStatus::ACTUAL);
+    ASSERT(records[0].ratings.empty());
+    ASSERT_EQUAL(records[1].status, DocumentStatus::BANNED);
+    ASSERT_EQUAL(records[1].ratings, (std::vector<int>{-1, 5}));
+    ASSERT_EQUAL(text, "caf\xc3\xa9 \"cat\"\tdog|plain|"s);
+
+    ASSERT_EQUAL(read_records("1\tACTUAL\t\ttext\n"s, DocumentFileFormat::TSV).size(), 1u);
+    // The lines above a malformed one are still delivered.
+    std::vector<DocumentRecord> partial;
+    {
+        std::ofstream out(path);
+        out << "1\tACTUAL\t1\tfirst\n2\tACTUAL\t1\tsecond\n3\tUNKNOWN\t1\tthird\n"s;
+    }
+    try {
+        ReadDocumentFile(path.string(), {}, [&partial](const DocumentRecord& record) {
+            partial.push_back(record);
+        });
+        ASSERT_HINT(false, "malformed line is accepted"s);
+    } catch (const std::invalid_argument& error) {
+        ASSERT_EQUAL(std::string(error.what()).substr(0, 7), "Line 3:"s);
+    }
+    ASSERT_EQUAL(partial.size(), 2u);
+
+    ASSERT_THROWS(read_records("1\tACTUAL\ttext\n"s, DocumentFileFormat::TSV), std::invalid_argument);
+    ASSERT_THROWS(read_records("x\tACTUAL\t\ttext\n"s, DocumentFileFormat::TSV), std::invalid_argument);
+    ASSERT_THROWS(read_records("{\"id\": 1}\n"s, DocumentFileFormat::JSONL), std::invalid_argument);
+    ASSERT_THROWS(read_records("{\"id\": 1, \"text\": \"a\"\n"s, DocumentFileFormat::JSONL), std::invalid_argument);
+
+    // Errors of the consumer stop the pipeline.
+    SearchServer search_server(""s);
+    {
+        std::ofstream out(path);
+        corpus.WriteDocuments(out, 0, 100);
+        corpus.WriteDocuments(out, 50, 1);
+    }
+    ASSERT_THROWS(IngestDocuments(search_server, path.string(), {DocumentFileFormat::TSV, 8, 1}), std::invalid_argument);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 100);
+
+    std::filesystem::remove(path);
+    ASSERT_THROWS(IngestDocuments(search_server, path.string()), std::runtime_error);
+}
+
+void TestMappedIndex() {
+    CorpusOptions options;
+    options.vocabulary_size = 1'000;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+
+    SearchServer search_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(search_server, 0, 300);
+    search_server.RemoveDocument(7);
+
+    QueryLogOptions query_options;
+    query_options.max_words = 6;
+    query_options.minus_ratio = 0.15;
+    const auto queries = QueryLogGenerator(corpus, query_options).Generate(100);
+
+    const std::string serialized = SerializeIndex(search_server, 1);
+    const FlatIndex flat_index(serialized);
+    ASSERT_EQUAL(flat_index.GetDocumentCount(), 299);
+    for (const std::string& query : queries) {
+        for (DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            ASSERT_HINT(HaveSameResults(flat_index.FindTopDocuments(query, status), search_server.FindTopDocuments(query, status)), query);
+        }
+        for (int document_id : {0, 42, 299}) {
+            ASSERT_HINT(flat_index.MatchDocument(query, document_id) == search_server.MatchDocument(query, document_id), query);
+        }
+    }
+    ASSERT_THROWS(flat_index.MatchDocument("cat"s, 7), std::out_of_range);
+    ASSERT_THROWS(flat_index.FindTopDocuments("--bad"s), std::invalid_argument);
+    ASSERT_THROWS(FlatIndex(serialized.substr(0, serialized.size() - 8)), std::invalid_argument);
+
+    // Corrupt contents within bounds are rejected too.
+    const auto corrupt = [&serialized](uint64_t FlatIndexHeader::*section, size_t index, auto value) {
+        std::string data = serialized;
+        const uint64_t offset = reinterpret_cast<const FlatIndexHeader*>(data.data())->*section + index * sizeof(value);
+        std::memcpy(data.data() + offset, &value, sizeof(value));
+        return data;
+    };
+    const FlatIndexHeader& header = *reinterpret_cast<const FlatIndexHeader*>(serialized.data());
+    const uint32_t second_slot = reinterpret_cast<const uint32_t*>(serialized.data() + header.term_hash_slots)[1];
+    ASSERT_THROWS(FlatIndex(corrupt(&FlatIndexHeader::posting_documents, 5, static_cast<uint32_t>(header.document_count))), std::invalid_argument);
+    ASSERT_THROWS(FlatIndex(corrupt(&FlatIndexHeader::posting_offsets, 1, header.posting_count + 1)), std::invalid_argument);
+    ASSERT_THROWS(FlatIndex(corrupt(&FlatIndexHeader::term_offsets, 0, uint64_t{1})), std::invalid_argument);
+    ASSERT_THROWS(FlatIndex(corrupt(&FlatIndexHeader::document_term_offsets, 1, ~uint64_t{0})), std::invalid_argument);
+    ASSERT_THROWS(FlatIndex(corrupt(&FlatIndexHeader::document_terms, 3, static_cast<uint32_t>(header.term_count))), std::invalid_argument);
+    ASSERT_THROWS(FlatIndex(corrupt(&FlatIndexHeader::term_hash_slots, 0, second_slot)), std::invalid_argument);
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / ("search_server_test_"s + std::to_string(getpid()));
+    std::filesystem::create_directories(directory);
+    ASSERT_THROWS(MappedIndex(directory.string()), std::runtime_error);
+
+    ASSERT_EQUAL(PublishIndex(search_server, directory.string()), 1u);
+    MappedIndex mapped_index(directory.string());
+    ASSERT_EQUAL(mapped_index.GetGeneration(), 1u);
+    ASSERT(!mapped_index.Refresh());
+    ASSERT(mapped_index.MatchDocument(queries[0], 42) == search_server.MatchDocument(queries[0], 42));
+
+    // A reader in another process attaches to the same files.
+    const pid_t child = fork();
+    if (child == 0) {
+        const MappedIndex reader(directory.string());
+        bool same = true;
+        for (const std::string& query : queries) {
+            same = same && HaveSameResults(reader.FindTopDocuments(query), search_server.FindTopDocuments(query));
+        }
+        _exit(same ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT(waitpid(child, &status, 0) == child);
+    ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    const auto old_snapshot = mapped_index.GetSnapshot();
+    const auto old_results = old_snapshot->FindTopDocuments(queries[0]);
+    corpus.AddDocumentsTo(search_server, 300, 100);
+    for (uint64_t generation = 2; generation <= 3; ++generation) {
+        ASSERT_EQUAL(PublishIndex(search_server, directory.string()), generation);
+        ASSERT(mapped_index.Refresh());
+        ASSERT_EQUAL(mapped_index.GetGeneration(), generation);
+    }
+    ASSERT(!std::filesystem::exists(directory / "index-1"));
+    ASSERT_EQUAL(mapped_index.GetSnapshot()->GetDocumentCount(), 399);
+    for (const std::string& query : queries) {
+        ASSERT_HINT(HaveSameResults(mapped_index.FindTopDocuments(query), search_server.FindTopDocuments(query)), query);
+    }
+    // The replaced generation stays mapped while a snapshot holds it.
+    ASSERT(HaveSameResults(old_snapshot->FindTopDocuments(queries[0]), old_results));
+    ASSERT_EQUAL(old_snapshot->GetGeneration(), 1u);
+
+    std::filesystem::remove_all(directory);
+}
+
+void TestFrozenSearchServer() {
+    std::vector<std::string> words;
+    for (int i = 0; i < 5'000; ++i) {
+        words.push_back("w"s + std::to_string(i));
+    }
+    const std::vector<std::string_view> keys(words.begin(), words.end());
+    const PerfectHash hash = BuildPerfectHash(keys);
+    ASSERT_EQUAL(hash.slots.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQUAL(FindPerfectHashCandidate(keys[i], hash.salt, hash.seeds.data(), hash.seeds.size(), hash.slots.data(), hash.slots.size()), i);
+    }
+    ASSERT_THROWS(BuildPerfectHash({"cat"sv, "dog"sv, "cat"sv}), std::invalid_argument);
+
+    CorpusOptions options;
+    options.vocabulary_size = 2'000;
+    const CorpusGenerator corpus(options);
+
+    SearchServer expected(corpus.GetStopWords());
+    SearchServer search_server(corpus.GetStopWords());
+    for (SearchServer* server : {&expected, &search_server}) {
+        corpus.AddDocumentsTo(*server, 0, 500);
+        for (int document_id = 0; document_id < 500; document_id += 7) {
+            server->RemoveDocument(document_id);
+        }
+    }
+    const FrozenSearchServer frozen = Freeze(std::move(search_server));
+    ASSERT_EQUAL(frozen.GetDocumentCount(), expected.GetDocumentCount());
+
+    QueryLogOptions query_options;
+    query_options.max_words = 8;
+    query_options.minus_ratio = 0.2;
+    const auto queries = QueryLogGenerator(corpus, query_options).Generate(200);
+    const auto is_even = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+    for (const std::string& query : queries) {
+        ASSERT_HINT(HaveSameResults(frozen.FindTopDocuments(query), expected.FindTopDocuments(query)), query);
+        ASSERT_HINT(HaveSameResults(frozen.FindTopDocuments(query, DocumentStatus::BANNED), expected.FindTopDocuments(query, DocumentStatus::BANNED)), query);
+        ASSERT_HINT(HaveSameResults(frozen.FindTopDocuments(query, is_even), expected.FindTopDocuments(query, is_even)), query);
+        ASSERT_HINT(HaveSameResults(frozen.FindTopDocuments(query, AnyDocument{}), expected.FindTopDocuments(query, AnyDocument{})), query);
+        for (int document_id : {1, 250, 499}) {
+            ASSERT_HINT(frozen.MatchDocument(query, document_id) == expected.MatchDocument(query, document_id), query);
+        }
+    }
+    ASSERT(frozen.FindTopDocuments("unknownword"s).empty());
+    ASSERT_THROWS(frozen.MatchDocument(queries[0], 7), std::out_of_range);
+    ASSERT_THROWS(frozen.FindTopDocuments("cat -"s), std::invalid_argument);
+
+    const MemoryStats stats = frozen.GetMemoryStats();
+    ASSERT(stats.total_bytes > 0);
+    ASSERT(stats.total_bytes < expected.GetMemoryStats().total_bytes);
+}
+
+void TestNumaSearchServer() {
+    CorpusOptions options;
+    options.vocabulary_size = 1'000;
+    const CorpusGenerator corpus(options);
+
+    SearchServer expected(corpus.GetStopWords());
+    corpus.AddDocumentsTo(expected, 0, 300);
+    SearchServer search_server(corpus.GetStopWords());
+    corpus.AddDocumentsTo(search_server, 0, 300);
+    const FrozenSearchServer frozen = Freeze(std::move(search_server));
+
+    QueryLogOptions query_options;
+    query_options.minus_ratio = 0.2;
+    const auto queries = QueryLogGenerator(corpus, query_options).Generate(500);
+
+    for (bool enabled : {true, false}) {
+        const NumaSearchServer numa_server(frozen, {enabled, 3});
+        ASSERT(numa_server.GetReplicaCount() >= 1);
+        ASSERT_EQUAL(numa_server.GetWorkerCount(), 3 * numa_server.GetReplicaCount());
+
+        for (int round = 0; round < 2; ++round) {
+            const auto results = numa_server.ProcessQueries(queries);
+            ASSERT_EQUAL(results.size(), queries.size());
+            for (size_t i = 0; i < queries.size(); ++i) {
+                ASSERT_HINT(HaveSameResults(results[i], expected.FindTopDocuments(queries[i])), queries[i]);
+            }
+        }
+        ASSERT(HaveSameResults(numa_server.FindTopDocuments(queries[0]), expected.FindTopDocuments(queries[0])));
+        ASSERT(numa_server.MatchDocument(queries[0], 42) == expected.MatchDocument(queries[0], 42));
+        ASSERT(numa_server.ProcessQueries({}).empty());
+
+        // An invalid query fails the batch without stopping the workers.
+        std::vector<std::string> invalid_queries = queries;
+        invalid_queries[250] = "cat --dog"s;
+        ASSERT_THROWS(numa_server.ProcessQueries(invalid_queries), std::invalid_argument);
+        ASSERT_EQUAL(numa_server.ProcessQueries(queries).size(), queries.size());
+    }
+}
+
+void TestDurableSearchServer() {
+    CorpusOptions options;
+    options.vocabulary_size = 1'000;
+    options.document_length_median = 20;
+    const CorpusGenerator corpus(options);
+
+    QueryLogOptions query_options;
+    query_options.max_words = 5;
+    query_options.minus_ratio = 0.1;
+    const auto queries = QueryLogGenerator(corpus, query_options).Generate(50);
+
+    const auto have_same_results = [&queries](const SearchServer& lhs, const SearchServer& rhs) {
+        for (const std::string& query : queries) {
+            if (!HaveSameResults(lhs.FindTopDocuments(query), rhs.FindTopDocuments(query))
+                || !HaveSameResults(lhs.FindTopDocuments(query, DocumentStatus::BANNED), rhs.FindTopDocuments(query, DocumentStatus::BANNED))) {
+                return false;
+            }
+        }
+        return lhs.GetDocumentCount() == rhs.GetDocumentCount();
+    };
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / ("search_server_durable_"s + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    const std::filesystem::path log_path = directory / "log";
+
+    SearchServer expected(corpus.GetStopWords());
+    {
+        DurableSearchServer search_server(directory.string(), corpus.GetStopWords());
+        ASSERT_EQUAL(search_server.GetReplayedCount(), 0u);
+        corpus.ForEachDocument(0, 200, [&](const GeneratedDocument& document) {
+            search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+            expected.AddDocument(document.id, document.text, document.status, document.ratings);
+        });
+        for (int document_id : {3, 50, 199, 1'000}) {
+            search_server.RemoveDocument(document_id);
+            expected.RemoveDocument(document_id);
+        }
+        ASSERT_THROWS(search_server.AddDocument(5, "duplicate"s, DocumentStatus::ACTUAL, {}), std::invalid_argument);
+        ASSERT_EQUAL(search_server.GetSequence(), 203u);
+    }
+    {
+        // Additions removed again later are skipped by the replay.
+        DurableSearchServer search_server(directory.string(), ""s);
+        ASSERT_EQUAL(search_server.GetReplayedCount(), 197u);
+        ASSERT(have_same_results(search_server.GetSearchServer(), expected));
+
+        search_server.SaveSnapshot();
+        ASSERT_EQUAL(std::filesystem::file_size(log_path), 0u);
+        corpus.ForEachDocument(200, 20, [&](const GeneratedDocument& document) {
+            search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+            expected.AddDocument(document.id, document.text, document.status, document.ratings);
+        });
+    }
+    {
+        DurableSearchServer search_server(directory.string(), ""s);
+        ASSERT_EQUAL(search_server.GetReplayedCount(), 20u);
+        ASSERT_EQUAL(search_server.GetSequence(), 223u);
+        ASSERT(have_same_results(search_server.GetSearchServer(), expected));
+    }
+
+    // A torn last record is dropped and cut off, and appends continue after it.
+    std::filesystem::resize_file(log_path, std::filesystem::file_size(log_path) - 3);
+    expected.RemoveDocument(219);
+    {
+        DurableSearchServer search_server(directory.string(), ""s);
+        ASSERT_EQUAL(search_server.GetReplayedCount(), 19u);
+        ASSERT(have_same_results(search_server.GetSearchServer(), expected));
+        search_server.RemoveDocument(0);
+        expected.RemoveDocument(0);
+    }
+    {
+        DurableSearchServer search_server(directory.string(), ""s);
+        ASSERT_EQUAL(search_server.GetReplayedCount(), 20u);
+        ASSERT(have_same_results(search_server.GetSearchServer(), expected));
+    }
+
+    // A damaged record followed by intact ones is not a torn tail: opening
+    // fails and the synced records after it stay in the file.
+    {
+        const uintmax_t log_size = std::filesystem::file_size(log_path);
+        std::fstream log(log_path, std::ios::binary | std::ios::in | std::ios::out);
+        log.seekg(20);
+        const char byte = static_cast<char>(log.get());
+        log.seekp(20);
+        log.put(static_cast<char>(byte ^ 0x5a));
+        log.close();
+        ASSERT_THROWS(DurableSearchServer(directory.string(), ""s), std::invalid_argument);
+        ASSERT_EQUAL(std::filesystem::file_size(log_path), log_size);
+
+        log.open(log_path, std::ios::binary | std::ios::in | std::ios::out);
+        log.seekp(20);
+        log.put(byte);
+    }
+
+    // Writers on several threads share fsyncs.
+    {
+        DurableSearchServer search_server(directory.string(), ""s);
+        const uint64_t syncs_before = search_server.GetLog().GetSyncCount();
+        std::vector<std::thread> writers;
+        for (int thread = 0; thread < 4; ++thread) {
+            writers.emplace_back([&search_server, &corpus, thread] {
+                corpus.ForEachDocument(1'000 + thread * 50, 50, [&search_server](const GeneratedDocument& document) {
+                    search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+                });
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        ASSERT(search_server.GetLog().GetSyncCount() - syncs_before <= 200u);
+    }
+    corpus.AddDocumentsTo(expected, 1'000, 200);
+    {
+        DurableSearchServer search_server(directory.string(), ""s);
+        ASSERT(have_same_results(search_server.GetSearchServer(), expected));
+    }
+
+    // A mutation whose record cannot be written throws and is neither
+    // applied nor saved by the next snapshot. The file size limit fails the
+    // write; SIGXFSZ would kill the process instead.
+    {
+        DurableSearchServer search_server(directory.string(), ""s);
+        rlimit limit{};
+        getrlimit(RLIMIT_FSIZE, &limit);
+        const rlimit saved_limit = limit;
+        limit.rlim_cur = std::filesystem::file_size(log_path) + 8;
+        const auto saved_handler = signal(SIGXFSZ, SIG_IGN);
+        ASSERT_EQUAL(setrlimit(RLIMIT_FSIZE, &limit), 0);
+        ASSERT_THROWS(search_server.AddDocument(5'000, "failed addition"s, DocumentStatus::ACTUAL, {1}), std::runtime_error);
+        ASSERT_THROWS(search_server.RemoveDocument(1'000), std::runtime_error);
+        setrlimit(RLIMIT_FSIZE, &saved_limit);
+        signal(SIGXFSZ, saved_handler);
+
+        ASSERT(!search_server.GetSearchServer().HasDocument(5'000));
+        ASSERT(search_server.GetSearchServer().HasDocument(1'000));
+        search_server.SaveSnapshot();
+        search_server.AddDocument(5'001, "after the failure"s, DocumentStatus::ACTUAL, {1});
+        expected.AddDocument(5'001, "after the failure"s, DocumentStatus::ACTUAL, {1});
+    }
+    {
+        DurableSearchServer search_server(directory.string(), ""s);
+        ASSERT(!search_server.GetSearchServer().HasDocument(5'000));
+        ASSERT(have_same_results(search_server.GetSearchServer(), expected));
+    }
+
+    std::filesystem::remove(log_path);
+    {
+        std::ofstream snapshot(directory / "snapshot", std::ios::binary | std::ios::in | std::ios::out);
+        snapshot.seekp(40);
+        snapshot.put('\x7f');
+    }
+    ASSERT_THROWS(DurableSearchServer(directory.string(), ""s), std::invalid_argument);
+
+    // A writer killed in the middle of its work loses nothing it has
+    // acknowledged.
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    int acknowledgements[2];
+    ASSERT(pipe(acknowledgements) == 0);
+    const pid_t child = fork();
+    if (child == 0) {
+        close(acknowledgements[0]);
+        try {
+            DurableSearchServer search_server(directory.string(), corpus.GetStopWords());
+            corpus.ForEachDocument(0, 1'000'000, [&search_server, &acknowledgements](const GeneratedDocument& document) {
+                search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+                if (write(acknowledgements[1], &document.id, sizeof(document.id)) != sizeof(document.id)) {
+                    _exit(1);
+                }
+            });
+        } catch (...) {
+        }
+        _exit(1);
+    }
+    close(acknowledgements[1]);
+    int acknowledged_id = -1;
+    while (acknowledged_id < 100 && read(acknowledgements[0], &acknowledged_id, sizeof(acknowledged_id)) == sizeof(acknowledged_id)) {
+    }
+    kill(child, SIGKILL);
+    int status = 0;
+    ASSERT(waitpid(child, &status, 0) == child);
+    ASSERT(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+    for (int document_id = 0; read(acknowledgements[0], &document_id, sizeof(document_id)) == sizeof(document_id);) {
+        acknowledged_id = document_id;
+    }
+    close(acknowledgements[0]);
+    ASSERT(acknowledged_id >= 100);
+
+    {
+        DurableSearchServer search_server(directory.string(), ""s);
+        const int document_count = search_server.GetSearchServer().GetDocumentCount();
+        // The one mutation in flight may or may not have reached the disk.
+        ASSERT(document_count == acknowledged_id + 1 || document_count == acknowledged_id + 2);
+        SearchServer recovered(corpus.GetStopWords());
+        corpus.AddDocumentsTo(recovered, 0, document_count);
+        ASSERT(have_same_results(search_server.GetSearchServer(), recovered));
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+void TestSearchServer() {
+    RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
+    RUN_TEST(TestMinusWordsExcludeDocuments);
+    RUN_TEST(TestMatchDocument);
+    RUN_TEST(TestMatchDocumentPoliciesAgree);
+    RUN_TEST(TestSortByRelevanceAndRating);
+    RUN_TEST(TestComputeAverageRating);
+    RUN_TEST(TestFilterByPredicateAndStatus);
+    RUN_TEST(TestSpecializedFilters);
+    RUN_TEST(TestComputeRelevance);
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestCompact);
+    RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestDocumentBitmap);
+    RUN_TEST(TestProcessQueries);
+    RUN_TEST(TestProcessQueriesBatched);
+    RUN_TEST(TestPrepareQuery);
+    RUN_TEST(TestPrefixQuery);
+    RUN_TEST(TestQueryBudget);
+    RUN_TEST(TestPerfProfile);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestPaginator);
+    RUN_TEST(TestPagedSearch);
+    RUN_TEST(TestRequestQueue);
+    RUN_TEST(TestCorpusGenerator);
+    RUN_TEST(TestDocumentFile);
+    RUN_TEST(TestMappedIndex);
+    RUN_TEST(TestFrozenSearchServer);
+    RUN_TEST(TestNumaSearchServer);
+    RUN_TEST(TestDurableSearchServer);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+void TestExcludeStopWordsFromAddedDocumentContent();
+
+void TestMinusWordsExcludeDocuments();
+
+void TestMatchDocument();
+
+void TestMatchDocumentPoliciesAgree();
+
+void TestSortByRelevanceAndRating();
+
+void TestComputeAverageRating();
+
+void TestFilterByPredicateAndStatus();
+
+void TestSpecializedFilters();
+
+void TestComputeRelevance();
+
+void TestRemoveDocument();
+
+void TestCompact();
+
+void TestRemoveDuplicates();
+
+void TestMemoryStats();
+
+void TestDocumentBitmap();
+
+void TestProcessQueries();
+
+void TestProcessQueriesBatched();
+
+void TestPrepareQuery();
+
+void TestPrefixQuery();
+
+void TestQueryBudget();
+
+void TestPerfProfile();
+
+void TestShardedSearchServer();
+
+void TestPaginator();
+
+void TestPagedSearch();
+
+void TestRequestQueue();
+
+void TestCorpusGenerator();
+
+void TestDocumentFile();
+
+void TestMappedIndex();
+
+void TestFrozenSearchServer();
+
+void TestNumaSearchServer();
+
+void TestDurableSearchServer();
+
+void TestSearchServer();
@@ -0,0 +1,8 @@
+#include "test_example_functions.h"
+
+#include <iostream>
+
+int main() {
+    TestSearchServer();
+    std::cerr << "Search server testing finished" << std::endl;
+}